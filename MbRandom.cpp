@@ -54,6 +54,8 @@ MbRandom::MbRandom(void) {
 	setSeed();
 	initializedFacTable = false;
 	availableNormalRv = false;
+	gamma1S = 10.0;
+	gamma2S = 0.0;
 }
 
 /*!
@@ -71,6 +73,8 @@ MbRandom::MbRandom(seedType x) {
 	setSeed(x, 0);
 	initializedFacTable = false;
 	availableNormalRv = false;
+	gamma1S = 10.0;
+	gamma2S = 0.0;
 }
 
 /*!
@@ -1238,6 +1242,30 @@ void MbRandom::setSeed(seedType seed1, seedType seed2) {
 		}
 }
 
+/*!
+ * This function sets the two seeds for the random number generator to those of stream
+ * number stream of a run started with seed. The seeds are worked out with splitmix64, so
+ * neighbouring streams are not related, and the streams do not depend on which thread
+ * uses them.
+ *
+ *
+ * \brief Initializes random number seeds for one of many streams.
+ * \param seed is the seed of the run.
+ * \param stream is the index of the stream.
+ * \return This function does not return anything. 
+ * \throws Does not throw an error.
+ */
+void MbRandom::setStream(seedType seed, unsigned long long stream) {
+
+	unsigned long long z = ((unsigned long long)seed << 32) + stream*0x9E3779B97F4A7C15ULL;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	z = z ^ (z >> 31);
+	seedType s1 = z & 0xFFFFFFFF;
+	seedType s2 = z >> 32;
+	setSeed(s1 == 0 ? 1 : s1, s2 == 0 ? 1 : s2);
+}
+
 /*!
  * This function gets the two seeds from the random number generator.
  *
@@ -1521,16 +1549,16 @@ double MbRandom::rndGamma(double s) {
 double MbRandom::rndGamma1(double s) {
 
 	double			r, x = 0.0, small = 1e-37, w;
-	static double   a, p, uf, ss = 10.0, d;
 	
-	if (s != ss) 
+	if (s != gamma1S) 
 		{
-		a  = 1.0 - s;
-		p  = a / (a + s * exp(-a));
-		uf = p * pow(small / a, s);
-		d  = a * log(a);
-		ss = s;
+		gamma1A  = 1.0 - s;
+		gamma1P  = gamma1A / (gamma1A + s * exp(-gamma1A));
+		gamma1Uf = gamma1P * pow(small / gamma1A, s);
+		gamma1D  = gamma1A * log(gamma1A);
+		gamma1S  = s;
 		}
+	double a = gamma1A, p = gamma1P, uf = gamma1Uf, d = gamma1D;
 	for (;;) 
 		{
 		r = uniformRv();
@@ -1561,16 +1589,16 @@ double MbRandom::rndGamma1(double s) {
 double MbRandom::rndGamma2(double s) {
 
 	double			r, d, f, g, x;
-	static double	b, h, ss = 0.0;
     
 
     
-	if (s != ss)
+	if (s != gamma2S)
 		{
-		b  = s - 1.0;
-		h  = sqrt(3.0 * s - 0.75);
-		ss = s;
+		gamma2B = s - 1.0;
+		gamma2H = sqrt(3.0 * s - 0.75);
+		gamma2S = s;
         }
+	double b = gamma2B, h = gamma2H;
 	for (;;)
 		{
 		r = uniformRv();
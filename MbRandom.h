@@ -73,6 +73,7 @@ class MbRandom {
 					  void   getSeed(seedType &seed1, seedType &seed2);                                                /*!< retreives the seeds                                                            */
 					  void   setSeed(void);                                                                            /*!< initializes the seeds using the current time                                   */
 		              void   setSeed(seedType seed1, seedType seed2);                                                  /*!< initializes the seeds                                                          */
+		              void   setStream(seedType seed, unsigned long long stream);                                      /*!< initializes the seeds for one of many streams from a seed                      */
 					double   chiSquareRv(double v);                                                   /* chi square */ /*!< Chi-square random variable                                                     */
                     double   chiSquarePdf(double v, double x);                                                         /*!< the chi-square probability density                                             */
                     double   lnChiSquarePdf(double v, double x);                                                       /*!< natural log of the chi-square probability density                              */
@@ -154,6 +155,8 @@ class MbRandom {
 		            double   facTable[1024];                                                                           /*!< a table containing the log of the factorial up to 1024                         */
 		              bool   availableNormalRv;                                                                        /*!< a boolean which is true if there is a normal random variable available         */
 		            double   extraNormalRv;                                                                            /*!< a normally-distributed random variable which                                   */
+		            double   gamma1A, gamma1P, gamma1Uf, gamma1S, gamma1D;                                             /*!< the constants rndGamma1 last worked out, and its shape parameter               */
+		            double   gamma2B, gamma2H, gamma2S;                                                                /*!< the constants rndGamma2 last worked out, and its shape parameter               */
 };
 
 
@@ -0,0 +1,37 @@
+/*
+ *  arena.cpp
+ *  Selection_Recombination
+ *
+ */
+
+#include "arena.h"
+#include "path.h"
+
+path_arena::~path_arena() {
+	for (int i = 0; i < paths.size(); i++) {
+		delete paths[i];
+	}
+	for (int i = 0; i < vectors.size(); i++) {
+		delete vectors[i];
+	}
+}
+
+path* path_arena::get_path() {
+	if (next_path == paths.size()) {
+		paths.push_back(new path());
+	}
+	path* p = paths[next_path];
+	next_path++;
+	p->clear();
+	return p;
+}
+
+std::vector<double>* path_arena::get_vector() {
+	if (next_vector == vectors.size()) {
+		vectors.push_back(new std::vector<double>());
+	}
+	std::vector<double>* v = vectors[next_vector];
+	next_vector++;
+	v->resize(0);
+	return v;
+}
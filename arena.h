@@ -0,0 +1,35 @@
+/*
+ *  arena.h
+ *  Selection_Recombination
+ *
+ */
+
+#pragma once
+
+#ifndef arena_H
+#define arena_H
+
+#include <vector>
+
+class path;
+
+//Hands out scratch paths and vectors for the proposals. Nothing is freed by reset(), it just
+//rewinds to the first object, so once the arena has grown to what one generation needs the
+//proposals stop going to the heap. The MCMC resets it at the start of every generation.
+class path_arena {
+public:
+	path_arena() {next_path = 0; next_vector = 0;};
+	~path_arena();
+	
+	path* get_path(); //an empty path, valid until the next reset()
+	std::vector<double>* get_vector(); //an empty vector, valid until the next reset()
+	void reset() {next_path = 0; next_vector = 0;};
+	
+private:
+	std::vector<path*> paths;
+	std::vector<std::vector<double>*> vectors;
+	int next_path;
+	int next_vector;
+};
+
+#endif
@@ -0,0 +1,345 @@
+/*
+ *  bench_kernels.cpp
+ *  Selection_Recombination
+ *
+ *  Micro-benchmarks for the kernels the MCMC spends its time in, on paths of a few lengths
+ *  and with the constant and horse population size histories. Prints JSON, so results can be
+ *  kept and compared between versions.
+ *
+ */
+
+#include "MbRandom.h"
+#include "arena.h"
+#include "measure.h"
+#include "param.h"
+#include "path.h"
+#include "popsize.h"
+#include "settings.h"
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include "math.h"
+
+static void usage() {
+	std::cerr << "usage: selection_bench [options] > results.json" << std::endl;
+	std::cerr << "-l n1,n2,...: path lengths (default 1000,10000,100000,1000000)" << std::endl;
+	std::cerr << "-d dir: where constant.pop and horse.all.pop are (default .)" << std::endl;
+	std::cerr << "-k name1,name2,...: only run these kernels (default all)" << std::endl;
+	std::cerr << "-m seconds: keep repeating each kernel for at least this long (default 0.2)" << std::endl;
+	std::cerr << "-T tests: tests to calibrate the rejection sampling of Wright-Fisher bridges (default 10)" << std::endl;
+	std::cerr << "-e seed: random number seed (default 1)" << std::endl;
+}
+
+static std::vector<std::string> split(std::string s) {
+	std::vector<std::string> parts;
+	std::istringstream in(s);
+	std::string cur;
+	while (std::getline(in, cur, ',')) {
+		parts.push_back(cur);
+	}
+	return parts;
+}
+
+//a population size history and how sr would be told to read it
+struct demography_case {
+	std::string name;
+	std::string file;
+	std::string N0; //-N, empty if the file is in diffusion units
+};
+
+//the time span of every path; the horse history has a breakpoint inside it
+static const double t_start = -0.2;
+static const double t_end = 0;
+
+struct bench_options {
+	std::vector<std::string> kernels;
+	double min_time;
+	int num_test;
+	int seed;
+
+	bool wanted(std::string name) {
+		if (kernels.size() == 0) {
+			return true;
+		}
+		for (int i = 0; i < kernels.size(); i++) {
+			if (kernels[i] == name) {
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+//one line of the results
+struct bench_result {
+	std::string kernel;
+	std::string demography;
+	int length;
+	int reps;
+	double mean;
+	double min;
+};
+
+//calls f until it has run for min_time seconds, at least once, and times each call
+template <class F>
+bench_result time_kernel(std::string kernel, demography_case& d, int length, bench_options& opt, F f) {
+	bench_result r;
+	r.kernel = kernel;
+	r.demography = d.name;
+	r.length = length;
+	r.reps = 0;
+	r.min = INFINITY;
+	double total = 0;
+	while (r.reps == 0 || total < opt.min_time) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		f();
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now()-start;
+		total += elapsed.count();
+		if (elapsed.count() < r.min) {
+			r.min = elapsed.count();
+		}
+		r.reps++;
+	}
+	r.mean = total/r.reps;
+	std::cerr << kernel << " " << d.name << " " << length << ": " << r.mean << " s" << std::endl;
+	return r;
+}
+
+//settings for a run of sr with paths of about length points
+static settings* make_settings(demography_case& d, int length, bench_options& opt) {
+	std::ostringstream dt, seed, num_test;
+	dt << (t_end-t_start)/length;
+	seed << opt.seed;
+	num_test << opt.num_test;
+	std::vector<std::string> args;
+	args.push_back("selection_bench");
+	args.push_back("-P");
+	args.push_back(d.file);
+	if (d.N0 != "") {
+		args.push_back("-N");
+		args.push_back(d.N0);
+	}
+	args.push_back("-d");
+	args.push_back(dt.str());
+	args.push_back("-e");
+	args.push_back(seed.str());
+	args.push_back("-T");
+	args.push_back(num_test.str());
+	std::vector<char*> argv;
+	for (int i = 0; i < args.size(); i++) {
+		argv.push_back(const_cast<char*>(args[i].c_str()));
+	}
+	return new settings(argv.size(), &argv[0]);
+}
+
+//an allele going from 5% to 90%, as a path with length evenly spaced points
+static path* make_path(int length) {
+	std::vector<double> traj(length);
+	std::vector<double> time(length);
+	for (int i = 0; i < length; i++) {
+		time[i] = t_end - (t_end-t_start)*(length-1-i)/(length-1); //never after t_end, which getTau can't take
+		double p = 0.05 + 0.85/(1.0+exp(-40.0*(time[i]-(t_start+t_end)/2.0)));
+		traj[i] = acos(1.0-2.0*p);
+	}
+	return new path(traj, time);
+}
+
+//samples of 20 chromosomes every 0.02, like exampleInput.txt
+static std::vector<sample_time*> make_samples(MbRandom* r) {
+	int counts[] = {0, 0, 0, 0, 0, 1, 1, 5, 10, 18, 18};
+	int num_samples = sizeof(counts)/sizeof(counts[0]);
+	std::vector<sample_time*> samples;
+	for (int i = 0; i < num_samples; i++) {
+		double t = t_end - (t_end-t_start)*(num_samples-1-i)/(num_samples-1);
+		samples.push_back(new sample_time(t, t, t, 20, counts[i], r));
+	}
+	return samples;
+}
+
+static void run_case(demography_case& d, int length, bench_options& opt, std::vector<bench_result>& results) {
+	settings* s = make_settings(d, length, opt);
+	popsize* rho = s->parse_popsize_file();
+	path* p = make_path(length);
+	std::vector<double> time_vec(length);
+	p->get_time(0, length-1, time_vec);
+	double x0 = p->get_traj(0);
+	double xt = p->get_traj(length-1);
+
+	if (opt.wanted("log_girsanov_wf_r")) {
+		MbRandom r(opt.seed);
+		cbpMeasure cbp(&r);
+		results.push_back(time_kernel("log_girsanov_wf_r", d, length, opt, [&]() {
+			cbp.log_girsanov_wf_r(p, 50, 100, rho, 0);
+		}));
+	}
+	if (opt.wanted("log_girsanov_wfwf_r")) {
+		MbRandom r(opt.seed);
+		cbpMeasure cbp(&r);
+		results.push_back(time_kernel("log_girsanov_wfwf_r", d, length, opt, [&]() {
+			cbp.log_girsanov_wfwf_r(p, 50, 55, 100, 110, rho);
+		}));
+	}
+	if (opt.wanted("getTau")) {
+		std::vector<double> tau_vec;
+		results.push_back(time_kernel("getTau", d, length, opt, [&]() {
+			rho->getTau(time_vec, tau_vec);
+		}));
+	}
+	if (opt.wanted("cbp_prop_bridge")) {
+		MbRandom r(opt.seed);
+		cbpMeasure cbp(&r);
+		results.push_back(time_kernel("cbp_prop_bridge", d, length, opt, [&]() {
+			delete cbp.prop_bridge(x0, xt, t_start, t_end, time_vec);
+		}));
+	}
+	if (opt.wanted("wf_prop_bridge")) {
+		MbRandom r(opt.seed);
+		wfMeasure wf(&r, 0);
+		wf.set_num_test(opt.num_test);
+		results.push_back(time_kernel("wf_prop_bridge", d, length, opt, [&]() {
+			delete wf.prop_bridge(x0, xt, t_start, t_end, time_vec);
+		}));
+	}
+	delete p;
+
+	if (opt.wanted("sampleProb") || opt.wanted("param_path_propose")) {
+		//a path through the samples, built the way mcmc does it
+		MbRandom r(opt.seed);
+		path_arena scratch;
+		wfMeasure wf(&r, 0);
+		wf.set_num_test(opt.num_test);
+		std::vector<sample_time*> samples = make_samples(&r);
+		wfSamplePath* samplePath = new wfSamplePath(samples, rho, &wf, *s, &r);
+		param_gamma alpha1(s->get_a1start(), &r);
+		param_gamma alpha2(s->get_a2start(), &r);
+		param_path pathParam(samplePath, &alpha1, &alpha2, &r, *s, &scratch);
+		param_F F(0.1, &r);
+		samplePath->set_F(&F);
+		samplePath->set_update_begin(0);
+		samplePath->set_old_index(-1);
+		samplePath->sampleLogLik();
+		samplePath->commitSampleLogLik();
+		int sampleLength = samplePath->get_length();
+
+		if (opt.wanted("sampleProb")) {
+			results.push_back(time_kernel("sampleProb", d, sampleLength, opt, [&]() {
+				samplePath->sampleProb();
+			}));
+		}
+		if (opt.wanted("param_path_propose")) {
+			//a path update that is always rejected, so the path stays the same
+			results.push_back(time_kernel("param_path_propose", d, sampleLength, opt, [&]() {
+				scratch.reset();
+				pathParam.propose();
+				samplePath->sampleLogLik();
+				pathParam.reset();
+				samplePath->rollbackSampleLogLik();
+			}));
+		}
+		for (int i = 0; i < samples.size(); i++) {
+			delete samples[i];
+		}
+		//deleting pathParam deletes the path, and the path deletes rho
+	} else {
+		delete rho;
+	}
+	delete s;
+}
+
+static void print_json(std::ostream& o, bench_options& opt, std::vector<bench_result>& results) {
+	o << "{" << std::endl;
+	o << "  \"seed\": " << opt.seed << "," << std::endl;
+	o << "  \"min_time\": " << opt.min_time << "," << std::endl;
+	o << "  \"num_test\": " << opt.num_test << "," << std::endl;
+	o << "  \"results\": [" << std::endl;
+	for (int i = 0; i < results.size(); i++) {
+		bench_result& r = results[i];
+		o << "    {\"kernel\": \"" << r.kernel << "\", \"demography\": \"" << r.demography << "\", \"length\": " << r.length;
+		o << ", \"reps\": " << r.reps << ", \"mean_s\": " << r.mean << ", \"min_s\": " << r.min << "}";
+		o << (i+1 < results.size() ? "," : "") << std::endl;
+	}
+	o << "  ]" << std::endl;
+	o << "}" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+	std::vector<int> lengths;
+	lengths.push_back(1000);
+	lengths.push_back(10000);
+	lengths.push_back(100000);
+	lengths.push_back(1000000);
+	std::string dir = ".";
+	bench_options opt;
+	opt.min_time = 0.2;
+	opt.num_test = 10;
+	opt.seed = 1;
+
+	int ac = 1;
+	while (ac < argc) {
+		if (argv[ac][0] != '-' || ac+1 >= argc) {
+			usage();
+			return 1;
+		}
+		switch(argv[ac][1]) {
+			case 'l': {
+				std::vector<std::string> l = split(argv[ac+1]);
+				lengths.resize(0);
+				for (int i = 0; i < l.size(); i++) {
+					lengths.push_back(atoi(l[i].c_str()));
+				}
+				break;
+			}
+			case 'd':
+				dir = argv[ac+1];
+				break;
+			case 'k':
+				opt.kernels = split(argv[ac+1]);
+				break;
+			case 'm':
+				opt.min_time = atof(argv[ac+1]);
+				break;
+			case 'T':
+				opt.num_test = atoi(argv[ac+1]);
+				break;
+			case 'e':
+				opt.seed = atoi(argv[ac+1]);
+				break;
+			default:
+				usage();
+				return 1;
+		}
+		ac += 2;
+	}
+	for (int i = 0; i < lengths.size(); i++) {
+		if (lengths[i] < 100) {
+			std::cerr << "ERROR: Paths need at least 100 points" << std::endl;
+			return 1;
+		}
+	}
+
+	std::vector<demography_case> demographies(2);
+	demographies[0].name = "constant";
+	demographies[0].file = dir + "/constant.pop";
+	demographies[0].N0 = "10000";
+	demographies[1].name = "horse";
+	demographies[1].file = dir + "/horse.all.pop";
+	demographies[1].N0 = "";
+
+	//the classes being timed talk on std::cout, so keep it for the JSON and send the rest to std::cerr
+	std::ostream json(std::cout.rdbuf());
+	std::cout.rdbuf(std::cerr.rdbuf());
+
+	std::vector<bench_result> results;
+	for (int i = 0; i < demographies.size(); i++) {
+		for (int j = 0; j < lengths.size(); j++) {
+			run_case(demographies[i], lengths[j], opt, results);
+		}
+	}
+	print_json(json, opt, results);
+	std::cout.rdbuf(json.rdbuf());
+	return 0;
+}
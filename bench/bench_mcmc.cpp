@@ -0,0 +1,422 @@
+/*
+ *  bench_mcmc.cpp
+ *  Selection_Recombination
+ *
+ *  Throughput of the whole sampler: runs sr's chain on fixed seeds over a set of scenarios and
+ *  reports generations per second, effective sample sizes per second, peak memory and the size
+ *  of the output. Prints JSON; given a baseline from an earlier run it also says what got worse.
+ *
+ */
+
+#include "selection.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "math.h"
+
+static void usage() {
+	std::cerr << "usage: selection_bench_mcmc [options] > results.json" << std::endl;
+	std::cerr << "-n generations: length of each chain (default 20000)" << std::endl;
+	std::cerr << "-s scenario1,scenario2,...: only run these (default all)" << std::endl;
+	std::cerr << "-d dir: where exampleInput.txt and the .pop files are (default .)" << std::endl;
+	std::cerr << "-o dir: where the chains write their output (default bench_out)" << std::endl;
+	std::cerr << "-b baseline.json: compare with an earlier run, exit with 1 if anything got worse" << std::endl;
+	std::cerr << "-r fraction: how much worse than the baseline is a regression (default 0.1)" << std::endl;
+}
+
+static std::vector<std::string> split(std::string s) {
+	std::vector<std::string> parts;
+	std::istringstream in(s);
+	std::string cur;
+	while (std::getline(in, cur, ',')) {
+		parts.push_back(cur);
+	}
+	return parts;
+}
+
+//a run of sr: its command line, apart from -n, -o and the things every scenario has
+struct scenario {
+	std::string name;
+	std::vector<std::string> args;
+};
+
+static void add_args(scenario& s, std::string args) {
+	std::istringstream in(args);
+	std::string a;
+	while (in >> a) {
+		s.args.push_back(a);
+	}
+}
+
+//data for the scenarios that don't use exampleInput.txt, written to the output directory
+static bool write_data(std::string fileName, std::string data) {
+	std::ofstream out(fileName.c_str());
+	out << data;
+	return out.good();
+}
+
+static std::vector<scenario> make_scenarios(std::string dir, std::string outDir) {
+	std::string example = " -D " + dir + "/exampleInput.txt -G 25 -N 10000 -P " + dir + "/constant.pop";
+	std::vector<scenario> scenarios(6);
+	scenarios[0].name = "constant_age";
+	add_args(scenarios[0], example + " -a");
+	scenarios[1].name = "constant_noage";
+	add_args(scenarios[1], example);
+	scenarios[2].name = "constant_ascertained";
+	add_args(scenarios[2], example + " -a -A 0.5");
+	scenarios[3].name = "horse_age";
+	add_args(scenarios[3], " -D " + outDir + "/horse_data.txt -P " + dir + "/horse.all.pop -a");
+	scenarios[4].name = "strong_selection";
+	add_args(scenarios[4], " -D " + outDir + "/strong_data.txt -G 25 -N 10000 -P " + dir + "/constant.pop -a");
+	scenarios[5].name = "weak_selection";
+	add_args(scenarios[5], " -D " + outDir + "/weak_data.txt -G 25 -N 10000 -P " + dir + "/constant.pop -a");
+	for (int i = 0; i < scenarios.size(); i++) {
+		add_args(scenarios[i], "-d 0.001 -F 20 -s 20 -f 1000000000 -e " + std::to_string(8067+i));
+	}
+	return scenarios;
+}
+
+static bool write_scenario_data(std::string outDir) {
+	//times in units of 2N generations, like horse.all.pop
+	return write_data(outDir + "/horse_data.txt",
+	                  "0\t10\t-0.6\t-0.55\n1\t10\t-0.4\t-0.4\n2\t10\t-0.2\t-0.18\n4\t10\t-0.1\t-0.1\n6\t10\t0\t0\n")
+	//a sweep in 20000 years
+	    && write_data(outDir + "/strong_data.txt",
+	                  "0\t20\t-20000\t-20000\n1\t20\t-16000\t-16000\n5\t20\t-12000\t-12000\n12\t20\t-8000\t-8000\n18\t20\t-4000\t-4000\n19\t20\t0\t0\n")
+	//drifting around 25% for 100000 years
+	    && write_data(outDir + "/weak_data.txt",
+	                  "4\t20\t-100000\t-100000\n5\t20\t-80000\t-80000\n6\t20\t-60000\t-60000\n5\t20\t-40000\t-40000\n4\t20\t-20000\t-20000\n5\t20\t0\t0\n");
+}
+
+//effective sample size, from Geyer's initial positive sequence of the autocorrelations
+static double ess(const std::vector<double>& x) {
+	int n = x.size();
+	if (n < 4) {
+		return NAN;
+	}
+	double mean = 0;
+	for (int i = 0; i < n; i++) {
+		mean += x[i];
+	}
+	mean /= n;
+	double var = 0;
+	for (int i = 0; i < n; i++) {
+		var += (x[i]-mean)*(x[i]-mean);
+	}
+	if (var == 0) {
+		return NAN;
+	}
+	double tau = -1;
+	for (int k = 0; k+1 < n; k += 2) {
+		double pair = 0;
+		for (int lag = k; lag <= k+1; lag++) {
+			double c = 0;
+			for (int i = 0; i+lag < n; i++) {
+				c += (x[i]-mean)*(x[i+lag]-mean);
+			}
+			pair += c/var;
+		}
+		if (pair <= 0) {
+			break;
+		}
+		tau += 2*pair;
+	}
+	return n/tau;
+}
+
+//keeps the columns the effective sample sizes are computed for
+class trace_sink : public mcmc_sink {
+public:
+	trace_sink() {names.push_back("alpha1"); names.push_back("alpha2"); names.push_back("age");};
+	void start(const std::vector<std::string>& columns) {
+		cols.assign(names.size(), -1);
+		traces.assign(names.size(), std::vector<double>());
+		for (int i = 0; i < names.size(); i++) {
+			for (int j = 0; j < columns.size(); j++) {
+				if (columns[j] == names[i]) {
+					cols[i] = j;
+				}
+			}
+		}
+	};
+	void sample(int gen, const std::vector<double>& values, wfSamplePath* p) {
+		for (int i = 0; i < names.size(); i++) {
+			if (cols[i] >= 0) {
+				traces[i].push_back(values[cols[i]]);
+			}
+		}
+	};
+
+	std::vector<std::string> names;
+	std::vector<int> cols; //-1 if the chain doesn't have it
+	std::vector<std::vector<double> > traces;
+};
+
+static long file_size(std::string fileName) {
+	struct stat st;
+	if (stat(fileName.c_str(), &st) != 0) {
+		return 0;
+	}
+	return st.st_size;
+}
+
+//runs one scenario and returns its line of the results, without the peak memory
+static std::string run_scenario(scenario& sc, int num_gen, std::string outDir) {
+	std::string baseName = outDir + "/" + sc.name;
+	std::vector<std::string> args;
+	args.push_back("sr");
+	args.insert(args.end(), sc.args.begin(), sc.args.end());
+	args.push_back("-n");
+	args.push_back(std::to_string(num_gen));
+	args.push_back("-o");
+	args.push_back(baseName);
+	std::vector<char*> argv;
+	for (int i = 0; i < args.size(); i++) {
+		argv.push_back(const_cast<char*>(args[i].c_str()));
+	}
+	settings s(argv.size(), &argv[0]);
+	MbRandom r(s.get_seed());
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	double seconds;
+	trace_sink traces;
+	{
+		mcmc chain(s, &r);
+		file_sink output(s);
+		chain.add_sink(&output);
+		chain.add_sink(&traces);
+		chain.run();
+		//run() has finished the file_sink, so the time includes setting up the chain and writing all the output
+		seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+	}
+	long bytes = file_size(baseName + ".param.gz") + file_size(baseName + ".traj.gz") + file_size(baseName + ".time.gz");
+
+	std::ostringstream line;
+	line << "{\"scenario\": \"" << sc.name << "\", \"generations\": " << num_gen << ", \"seconds\": " << seconds;
+	line << ", \"gens_per_s\": " << num_gen/seconds;
+	for (int i = 0; i < traces.names.size(); i++) {
+		if (traces.cols[i] < 0) {
+			continue;
+		}
+		//leave out the first quarter as burn-in
+		std::vector<double>& t = traces.traces[i];
+		std::vector<double> kept(t.begin()+t.size()/4, t.end());
+		double e = ess(kept);
+		if (!isnan(e)) {
+			line << ", \"ess_" << traces.names[i] << "_per_s\": " << e/seconds;
+		}
+	}
+	line << ", \"output_bytes\": " << bytes;
+	return line.str();
+}
+
+//runs the scenario in a child process, so each one has its own peak memory
+static bool run_child(scenario& sc, int num_gen, std::string outDir, std::string& result) {
+	int fd[2];
+	if (pipe(fd) != 0) {
+		return false;
+	}
+	std::cout.flush();
+	std::cerr.flush();
+	pid_t pid = fork();
+	if (pid < 0) {
+		return false;
+	}
+	if (pid == 0) {
+		close(fd[0]);
+		//sr talks on std::cout, which is for the results
+		std::cout.rdbuf(std::cerr.rdbuf());
+		std::string line = run_scenario(sc, num_gen, outDir) + "\n";
+		ssize_t written = write(fd[1], line.c_str(), line.size());
+		close(fd[1]);
+		_exit(written == (ssize_t)line.size() ? 0 : 1);
+	}
+	close(fd[1]);
+	result = "";
+	char buf[4096];
+	ssize_t got;
+	while ((got = read(fd[0], buf, sizeof(buf))) > 0) {
+		result.append(buf, got);
+	}
+	close(fd[0]);
+	int status;
+	struct rusage usage;
+	if (wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0 || result.size() == 0) {
+		return false;
+	}
+	//ru_maxrss is in kB on Linux
+	std::ostringstream rss;
+	rss << ", \"peak_rss_kb\": " << usage.ru_maxrss << "}";
+	result = result.substr(0, result.size()-1) + rss.str();
+	return true;
+}
+
+//the number after "key": on a results line, NAN if it isn't there
+static double get_number(std::string line, std::string key) {
+	std::string tag = "\"" + key + "\": ";
+	size_t pos = line.find(tag);
+	if (pos == std::string::npos) {
+		return NAN;
+	}
+	return atof(line.c_str()+pos+tag.size());
+}
+
+static std::string get_scenario(std::string line) {
+	std::string tag = "\"scenario\": \"";
+	size_t pos = line.find(tag);
+	if (pos == std::string::npos) {
+		return "";
+	}
+	pos += tag.size();
+	return line.substr(pos, line.find('"', pos)-pos);
+}
+
+//compares each number of results with the same one in the baseline; returns the number of regressions
+static int compare(std::vector<std::string>& results, std::string baselineName, double threshold) {
+	std::ifstream in(baselineName.c_str());
+	if (!in.good()) {
+		std::cerr << "ERROR: could not read " << baselineName << std::endl;
+		exit(1);
+	}
+	std::vector<std::string> baseline;
+	std::string line;
+	while (std::getline(in, line)) {
+		if (get_scenario(line) != "") {
+			baseline.push_back(line);
+		}
+	}
+	//bigger is better for the rates, smaller for memory and output
+	const char* higher[] = {"gens_per_s", "ess_alpha1_per_s", "ess_alpha2_per_s", "ess_age_per_s"};
+	const char* lower[] = {"peak_rss_kb", "output_bytes"};
+	int regressions = 0;
+	for (int i = 0; i < results.size(); i++) {
+		std::string name = get_scenario(results[i]);
+		std::string base = "";
+		for (int j = 0; j < baseline.size(); j++) {
+			if (get_scenario(baseline[j]) == name) {
+				base = baseline[j];
+			}
+		}
+		if (base == "") {
+			std::cerr << name << ": not in the baseline" << std::endl;
+			continue;
+		}
+		if (get_number(results[i], "generations") != get_number(base, "generations")) {
+			std::cerr << name << ": the baseline ran a different number of generations" << std::endl;
+			continue;
+		}
+		for (int k = 0; k < 6; k++) {
+			bool up = k < 4;
+			std::string key = up ? higher[k] : lower[k-4];
+			double cur = get_number(results[i], key);
+			double old = get_number(base, key);
+			if (isnan(cur) || isnan(old) || old == 0) {
+				continue;
+			}
+			double change = cur/old-1;
+			bool worse = up ? change < -threshold : change > threshold;
+			std::cerr << name << "\t" << key << "\t" << old << " -> " << cur << "\t" << (change > 0 ? "+" : "") << 100*change << "%";
+			if (worse) {
+				std::cerr << "\tREGRESSION";
+				regressions++;
+			}
+			std::cerr << std::endl;
+		}
+	}
+	return regressions;
+}
+
+int main(int argc, char* argv[]) {
+	int num_gen = 20000;
+	std::string wanted = "";
+	std::string dir = ".";
+	std::string outDir = "bench_out";
+	std::string baselineName = "";
+	double threshold = 0.1;
+
+	int ac = 1;
+	while (ac < argc) {
+		if (argv[ac][0] != '-' || ac+1 >= argc) {
+			usage();
+			return 1;
+		}
+		switch(argv[ac][1]) {
+			case 'n':
+				num_gen = atoi(argv[ac+1]);
+				break;
+			case 's':
+				wanted = argv[ac+1];
+				break;
+			case 'd':
+				dir = argv[ac+1];
+				break;
+			case 'o':
+				outDir = argv[ac+1];
+				break;
+			case 'b':
+				baselineName = argv[ac+1];
+				break;
+			case 'r':
+				threshold = atof(argv[ac+1]);
+				break;
+			default:
+				usage();
+				return 1;
+		}
+		ac += 2;
+	}
+	if (num_gen < 1) {
+		usage();
+		return 1;
+	}
+
+	mkdir(outDir.c_str(), 0755);
+	if (!write_scenario_data(outDir)) {
+		std::cerr << "ERROR: could not write the data files in " << outDir << std::endl;
+		return 1;
+	}
+	std::vector<scenario> scenarios = make_scenarios(dir, outDir);
+	std::vector<std::string> names = split(wanted);
+
+	std::vector<std::string> results;
+	for (int i = 0; i < scenarios.size(); i++) {
+		bool run = names.size() == 0;
+		for (int j = 0; j < names.size(); j++) {
+			run = run || names[j] == scenarios[i].name;
+		}
+		if (!run) {
+			continue;
+		}
+		std::cerr << "running " << scenarios[i].name << std::endl;
+		std::string result;
+		if (!run_child(scenarios[i], num_gen, outDir, result)) {
+			std::cerr << "ERROR: scenario " << scenarios[i].name << " failed" << std::endl;
+			return 1;
+		}
+		std::cerr << result << std::endl;
+		results.push_back(result);
+	}
+
+	std::cout << "{" << std::endl;
+	std::cout << "  \"results\": [" << std::endl;
+	for (int i = 0; i < results.size(); i++) {
+		std::cout << "    " << results[i] << (i+1 < results.size() ? "," : "") << std::endl;
+	}
+	std::cout << "  ]" << std::endl;
+	std::cout << "}" << std::endl;
+
+	if (baselineName != "" && compare(results, baselineName, threshold) > 0) {
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,77 @@
+/*
+ *  blocks.h
+ *  Selection_Recombination
+ *
+ */
+
+#pragma once
+
+#ifndef blocks_H
+#define blocks_H
+
+#include "MbRandom.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+//Many independent draws on worker threads, for -B and -S: the items are split into blocks, each
+//with its own random number stream worked out from the seed and the block's index, so the results
+//don't depend on the number of threads, and handed back in order.
+
+//items per random number stream
+static const int block_size = 64;
+
+template <class R>
+struct item_block {
+	item_block(int f, int c) {first = f; count = c;};
+
+	int first; //index of the first item
+	int count;
+	std::vector<R> results;
+};
+
+template <class R, class work_f>
+void work_item_block(item_block<R>* b, work_f* work, unsigned int seed) {
+	MbRandom r(1);
+	r.setStream(seed, b->first/block_size);
+	b->results.resize(b->count);
+	(*work)(r, b->first, b->results);
+}
+
+//calls work(MbRandom& r, first, results) for each block of items on num_threads threads, where
+//results has an R for each item of the block from first on, and then collect(item, R& result)
+//for every item in order. One block per thread in each round; the threads make round k+1 while
+//round k is collected.
+template <class R, class work_f, class collect_f>
+void for_each_item_block(int num_items, int num_threads, unsigned int seed, work_f work, collect_f collect) {
+	int num_blocks = (num_items+block_size-1)/block_size;
+	int num_rounds = (num_blocks+num_threads-1)/num_threads;
+	std::vector<item_block<R> > blocks[2];
+	for (int round = 0; round <= num_rounds; round++) {
+		std::vector<std::thread> workers;
+		if (round < num_rounds) {
+			std::vector<item_block<R> >& cur = blocks[round%2];
+			cur.clear();
+			for (int b = round*num_threads; b < num_blocks && b < (round+1)*num_threads; b++) {
+				cur.push_back(item_block<R>(b*block_size, std::min(block_size, num_items-b*block_size)));
+			}
+			for (int i = 0; i < cur.size(); i++) {
+				workers.push_back(std::thread(work_item_block<R, work_f>, &cur[i], &work, seed));
+			}
+		}
+		if (round > 0) {
+			std::vector<item_block<R> >& done = blocks[(round-1)%2];
+			for (int i = 0; i < done.size(); i++) {
+				for (int j = 0; j < done[i].count; j++) {
+					collect(done[i].first+j, done[i].results[j]);
+				}
+				done[i].results.clear();
+			}
+		}
+		for (int i = 0; i < workers.size(); i++) {
+			workers[i].join();
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,97 @@
+/*
+ *  bridges.cpp
+ *  Selection_Recombination
+ *
+ */
+
+#include "bridges.h"
+#include "MbRandom.h"
+#include "blocks.h"
+#include "measure.h"
+#include "path.h"
+#include "settings.h"
+#include "textbuf.h"
+#include "trajfile.h"
+
+#include <iostream>
+#include <chrono>
+#include <stdlib.h>
+
+//one bridge, made by a worker thread
+struct bridge {
+	std::vector<double> freq;
+	long tries; //proposals, accepted or not
+};
+
+void make_bridges(settings& s, MbRandom* r) {
+	std::vector<double> pars = s.parse_bridge_pars();
+	int num_bridges = s.get_num_bridges();
+	int num_threads = s.get_num_threads();
+	std::cerr << "Creating " << num_bridges << " bridges with (x0, xt, gamma, t) = (" << pars[0] << ", " << pars[1]
+	    << ", " << pars[2] << ", " << pars[3] << ") on " << num_threads << " threads" << std::endl;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	wfMeasure calib(r, pars[2]);
+	calib.set_num_test(s.get_num_test());
+	double x0 = calib.fisher(pars[0]);
+	double xt = calib.fisher(pars[1]);
+	std::vector<double> time;
+	path::time_grid(0, pars[3], s, time);
+	double rescale = calib.calibrate(x0, xt, 0, pars[3], time);
+
+	traj_writer bin;
+	if (s.get_binary_bits()) {
+		std::string binName = s.get_baseName() + ".traj.bin";
+		if (!bin.open(binName, s.get_binary_bits(), s.get_gz_buffer())) {
+			std::cerr << "ERROR: could not open " << binName << std::endl;
+			exit(1);
+		}
+	} else {
+		std::cout << "bridge\ttrajectory\ttime" << std::endl;
+	}
+	text_buffer line;
+
+	long tries = 0;
+	for_each_item_block<bridge>(num_bridges, num_threads, s.get_seed(),
+		[&](MbRandom& r, int first, std::vector<bridge>& bridges) {
+			wfMeasure wf(&r, pars[2]);
+			for (int i = 0; i < bridges.size(); i++) {
+				long before = wf.get_tries();
+				path* p = wf.prop_bridge(x0, xt, 0, pars[3], time, rescale);
+				wf.invert_path(p);
+				bridges[i].freq = p->get_traj();
+				bridges[i].tries = wf.get_tries()-before;
+				delete p;
+			}
+		},
+		[&](int num, bridge& b) {
+			if (s.get_binary_bits()) {
+				if (!bin.write(num, b.freq, time, num > 0)) {
+					std::cerr << "ERROR: could not write bridge " << num << std::endl;
+					exit(1);
+				}
+			} else {
+				for (int k = 0; k < b.freq.size(); k++) {
+					line.clear();
+					line.add(num);
+					line.add('\t');
+					line.add(b.freq[k]);
+					line.add('\t');
+					line.add(time[k]);
+					line.add('\n');
+					line.write_to(std::cout);
+				}
+			}
+			tries += b.tries;
+		});
+	if (s.get_binary_bits() && !bin.close()) {
+		std::cerr << "ERROR: could not finish writing the binary trajectory file" << std::endl;
+		exit(1);
+	}
+	std::cout.flush();
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+	std::cerr << "Made " << num_bridges << " bridges of " << time.size() << " points in " << seconds << " seconds ("
+	    << num_bridges/seconds << " per second)" << std::endl;
+	std::cerr << "Proposed " << tries << " Bessel bridges, acceptance rate " << double(num_bridges)/tries << std::endl;
+}
@@ -0,0 +1,25 @@
+/*
+ *  bridges.h
+ *  Selection_Recombination
+ *
+ */
+
+#pragma once
+
+#ifndef bridges_H
+#define bridges_H
+
+#include <vector>
+
+class settings;
+class MbRandom;
+
+//-b x0,xt,gamma,t with -B count: count bridges with the same end points, made on -J threads.
+//The rejection sampling envelope is calibrated once, with r, and then every block of bridges
+//has its own random number stream worked out from the seed and the block's index, so the
+//bridges don't depend on the number of threads. They are written in order, as tsv on
+//std::cout (bridge, frequency, time) or with -W to output_prefix.traj.bin, one record per
+//bridge. Throughput and the acceptance rate go to std::cerr at the end.
+void make_bridges(settings& s, MbRandom* r);
+
+#endif
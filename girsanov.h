@@ -0,0 +1,349 @@
+/*
+ *  girsanov.h
+ *  Selection_Recombination
+ *
+ */
+
+#pragma once
+
+#ifndef girsanov_H
+#define girsanov_H
+
+#include "measure.h"
+#include "path.h"
+#include "popsize.h"
+#include "math.h"
+#include <vector>
+
+//One trapezoid rule pass over a path for all the Girsanov likelihoods in measure.cpp. Uses Ito's
+//formula to avoid the Ito integral, so the log likelihood ratio is
+//    H(end) - H(start) - 1/2 int da/dx dt - 1/2 int a^2 dt - int dH/dt dt
+//
+//The integrand policy has
+//    double H(double x, double t, double N)     potential
+//    double a2(double x, double t, double N)    square of the drift (plus whatever cancels with it)
+//    double dadx(double x, double t, double N)  derivative of the drift
+//    double dHdt(double x, double t, double dN) time derivative of the potential
+//    bool out_of_bounds(double x)               the likelihood is 0 if a point of the path is
+//    static const bool time_dependent;          false if dHdt is always 0
+//    static const bool check_ends;              whether out_of_bounds applies to the last point
+//                                               of each epoch, as well as the ones inside it
+//where N is the population size at the point and dN its time derivative, from a demography
+//policy (popsize.h, or no_demography for the measures that don't depend on it). The integral
+//is split at the epoch breakpoints, with the size at the last point of an epoch taken as a
+//left limit.
+
+//The integrand's functions can return something other than a double, as long as it can be
+//added, subtracted and scaled like one (see alpha_quadratic); the sums are then of that type.
+template <class T>
+struct girsanov_sums_t {
+	T H_start; //H at the start of each epoch
+	T H_end; //and at the end, as a left limit
+	T int_deriv;
+	T int_square;
+	T int_time;
+
+	T log_ratio() {return H_end-H_start-int_deriv*0.5-int_square*0.5-int_time;};
+};
+typedef girsanov_sums_t<double> girsanov_sums;
+
+//for the measures that don't depend on the population size
+class no_demography {
+public:
+	static const bool constant = true;
+	double size(double t, bool leftLim) {return 1;};
+	double deriv(double t, bool leftLim) {return 0;};
+	const double* breaks(double t0, double t, int& n) {dconts[0] = t0; dconts[1] = t; n = 2; return dconts;};
+
+private:
+	double dconts[2];
+};
+
+//false if a point of the path was out of bounds; otherwise the sums are in s
+template <class integrand, class demography, class T>
+inline bool integrate_girsanov(path* p, integrand& f, demography& rho, girsanov_sums_t<T>& s) {
+	int n = p->get_length();
+	std::vector<double>::iterator x = p->get_traj_iterator(0);
+	std::vector<double>::iterator t = p->get_time_iterator(0);
+	s.H_start = T(0);
+	s.H_end = T(0);
+	s.int_deriv = T(0);
+	s.int_square = T(0);
+	s.int_time = T(0);
+
+	int num_dconts;
+	const double* dconts = rho.breaks(t[0], t[n-1], num_dconts);
+	int i = 0;
+	for (int j = 0; j < num_dconts-1; j++) {
+		//the point the epoch starts at, on the right of the breakpoint
+		double N = rho.size(t[i], 0);
+		s.H_start += f.H(x[i], t[i], N);
+		T last_deriv = f.dadx(x[i], t[i], N);
+		T last_square = f.a2(x[i], t[i], N);
+		T last_time = integrand::time_dependent && !demography::constant ? f.dHdt(x[i], t[i], rho.deriv(t[i], 0)) : T(0);
+		i++;
+		//the points inside the epoch
+		while (i < n-1 && t[i] < dconts[j+1]) {
+			if (f.out_of_bounds(x[i])) {
+				return false;
+			}
+			N = rho.size(t[i], 0);
+			double dt = t[i]-t[i-1];
+			T deriv = f.dadx(x[i], t[i], N);
+			T square = f.a2(x[i], t[i], N);
+			s.int_deriv += (deriv+last_deriv)/2.0*dt;
+			s.int_square += (square+last_square)/2.0*dt;
+			last_deriv = deriv;
+			last_square = square;
+			if (integrand::time_dependent && !demography::constant) {
+				T time = f.dHdt(x[i], t[i], rho.deriv(t[i], 0));
+				s.int_time += (time+last_time)/2.0*dt;
+				last_time = time;
+			}
+			i++;
+		}
+		//and the last little bit, where I need a left limit
+		if (integrand::check_ends && f.out_of_bounds(x[i])) {
+			return false;
+		}
+		N = rho.size(t[i], 1);
+		double dt = t[i]-t[i-1];
+		s.int_deriv += (f.dadx(x[i], t[i], N)+last_deriv)/2.0*dt;
+		s.int_square += (f.a2(x[i], t[i], N)+last_square)/2.0*dt;
+		if (integrand::time_dependent && !demography::constant) {
+			s.int_time += (f.dHdt(x[i], t[i], rho.deriv(t[i], 1))+last_time)/2.0*dt;
+		}
+		s.H_end += f.H(x[i], t[i], N);
+	}
+	return true;
+}
+
+//Every other point of p into x2 and t2, for an estimate of the error of the trapezoid rule from
+//the same path on a grid twice as coarse. The last point and the first point at or after each
+//of rho's breakpoints are always kept, so the integrals over it have the same epochs and ends.
+template <class demography>
+void every_other_point(path* p, demography& rho, std::vector<double>& x2, std::vector<double>& t2) {
+	int n = p->get_length();
+	std::vector<double>::iterator x = p->get_traj_iterator(0);
+	std::vector<double>::iterator t = p->get_time_iterator(0);
+	int num_dconts;
+	const double* dconts = rho.breaks(t[0], t[n-1], num_dconts);
+	x2.resize(0);
+	t2.resize(0);
+	int j = 1; //the next breakpoint inside the path
+	bool keep = true;
+	for (int i = 0; i < n; i++) {
+		bool epoch_end = false;
+		while (j < num_dconts-1 && t[i] >= dconts[j]) {
+			epoch_end = true;
+			j++;
+		}
+		if (keep || epoch_end || i == n-1) {
+			x2.push_back(x[i]);
+			t2.push_back(t[i]);
+			keep = false;
+		} else {
+			keep = true;
+		}
+	}
+}
+
+//any measure, through its virtual functions
+class measure_integrand {
+public:
+	static const bool time_dependent = false;
+	static const bool check_ends = true;
+	measure_integrand(measure* mm, double l, double u) {m = mm; lower = l; upper = u;};
+	double H(double x, double t, double N) {return m->H(x, t);};
+	double a2(double x, double t, double N) {return pow(m->a(x, t), 2);};
+	double dadx(double x, double t, double N) {return m->dadx(x, t);};
+	double dHdt(double x, double t, double dN) {return 0;};
+	bool out_of_bounds(double x) {return x < lower || x > upper;};
+
+private:
+	measure* m;
+	double lower;
+	double upper;
+};
+
+//the same for a wfMeasure, without the virtual calls
+class wf_integrand {
+public:
+	static const bool time_dependent = false;
+	static const bool check_ends = true;
+	wf_integrand(wfMeasure* mm, double l, double u) {m = mm; lower = l; upper = u;};
+	double H(double x, double t, double N) {return m->wfMeasure::H(x, t);};
+	double a2(double x, double t, double N) {return pow(m->wfMeasure::a(x, t), 2);};
+	double dadx(double x, double t, double N) {return m->wfMeasure::dadx(x, t);};
+	double dHdt(double x, double t, double dN) {return 0;};
+	bool out_of_bounds(double x) {return x < lower || x > upper;};
+
+private:
+	wfMeasure* m;
+	double lower;
+	double upper;
+};
+
+//Wright-Fisher wrt Bessel measure with appropriate cancelling
+class cbp_wf_integrand {
+public:
+	static const bool time_dependent = false;
+	static const bool check_ends = false;
+	cbp_wf_integrand(cbpMeasure* mm, double a) {m = mm; alpha = a;};
+	double H(double x, double t, double N) {return m->H_wf(x, t, alpha);};
+	double a2(double x, double t, double N) {return m->a2_wf(x, t, alpha);};
+	double dadx(double x, double t, double N) {return m->dadx_wf(x, t, alpha);};
+	double dHdt(double x, double t, double dN) {return 0;};
+	bool out_of_bounds(double x) {return false;};
+
+private:
+	cbpMeasure* m;
+	double alpha;
+};
+
+//Wright-Fisher relative to Wright-Fisher
+class cbp_wfwf_integrand {
+public:
+	static const bool time_dependent = false;
+	static const bool check_ends = true;
+	cbp_wfwf_integrand(cbpMeasure* mm, double a1, double a2) {m = mm; alpha1 = a1; alpha2 = a2;};
+	double H(double x, double t, double N) {return m->H_wfwf(x, t, alpha1, alpha2);};
+	double a2(double x, double t, double N) {return m->a2_wfwf(x, t, alpha1, alpha2);};
+	double dadx(double x, double t, double N) {return m->dadx_wfwf(x, t, alpha1, alpha2);};
+	double dHdt(double x, double t, double dN) {return 0;};
+	bool out_of_bounds(double x) {return x < 0 || x >= PI;};
+
+private:
+	cbpMeasure* m;
+	double alpha1;
+	double alpha2;
+};
+
+//Wright-Fisher with variable population size wrt Bessel measure with appropriate cancelling
+class cbp_wf_r_integrand {
+public:
+	static const bool time_dependent = true;
+	static const bool check_ends = false;
+	cbp_wf_r_integrand(double a1, double a2) {alpha1 = a1; alpha2 = a2;};
+	double H(double x, double t, double N) {
+		if (x == 0) {
+			return -1.0/8.0*N*(2*alpha1+alpha2);
+		} else {
+			return log(x)/2.0-1.0/8.0*(N*cos(x)*(2*alpha2+(2*alpha1-alpha2)*cos(x))+4*log(sin(x)));
+		}
+	};
+	double a2(double x, double t, double N) {
+		if (x == 0) {
+			return -1.0/6.0*(1.0/N+3.0*alpha1);
+		} else {
+			return 1.0/(16.0*N)*pow(N*sin(x)*(alpha2+(2*alpha1-alpha2)*cos(x))-2*1/tan(x),2)
+			- 1.0/(4.0*x*x*N);
+		}
+	};
+	double dadx(double x, double t, double N) {
+		if (x == 0) {
+			return 1.0/6.0*(1.0/N+3.0*alpha1);
+		} else {
+			return 1.0/2.0*(alpha1*cos(x)+1.0/(sin(x)*sin(x)*N))-1.0/(2.0*x*x*N);
+		}
+	};
+	double dHdt(double x, double t, double dN) {return -1.0/8.0*dN*cos(x)*(2*alpha2+(2*alpha1-alpha2)*cos(x));};
+	bool out_of_bounds(double x) {return x < 0 || x >= PI;};
+
+private:
+	double alpha1;
+	double alpha2;
+};
+
+//Wright-Fisher with variable population size relative to Wright-Fisher with variable population size
+class cbp_wfwf_r_integrand {
+public:
+	static const bool time_dependent = true;
+	static const bool check_ends = false;
+	cbp_wfwf_r_integrand(double a1, double a1p, double a2, double a2p) {alpha1 = a1; alpha1p = a1p; alpha2 = a2; alpha2p = a2p;};
+	double H(double x, double t, double N) {
+		return 1.0/8.0*N*cos(x)*(2*(alpha2-alpha2p)+(2*(alpha1-alpha1p)+alpha2p-alpha2)*cos(x));
+	};
+	double a2(double x, double t, double N) {
+		return 1.0/64.0*(alpha2p-alpha2+(2*(alpha1p-alpha1)+alpha2-alpha2p)
+		                 *cos(x))*((-16.0+2.0*N*(alpha1+alpha1p)
+		                 -N*(alpha2+alpha2p))
+		                 *cos(x) + (-2.0*(alpha1+alpha1p)+alpha2+alpha2p)
+		                 *N*cos(3*x)+4*(alpha2+alpha2p)
+		                 *N*sin(x)*sin(x));
+	};
+	double dadx(double x, double t, double N) {return 1.0/2.0*(alpha1p-alpha1)*cos(x);};
+	double dHdt(double x, double t, double dN) {
+		return 1.0/8.0*dN*cos(x)*(2*(alpha2-alpha2p)+(2*(alpha1-alpha1p)+alpha2p-alpha2)*cos(x));
+	};
+	bool out_of_bounds(double x) {return x < 0 || x > PI;};
+
+private:
+	double alpha1;
+	double alpha1p;
+	double alpha2;
+	double alpha2p;
+};
+
+//c0 + c1 alpha1 + c2 alpha2 + c11 alpha1^2 + c12 alpha1 alpha2 + c22 alpha2^2, for integrating
+//the parts of a likelihood that depend on the selection coefficients once for all of them
+struct alpha_quadratic {
+	double c[6]; //c0, c1, c2, c11, c12, c22
+
+	alpha_quadratic(double c0 = 0) {c[0] = c0; c[1] = c[2] = c[3] = c[4] = c[5] = 0;};
+	alpha_quadratic(double c0, double c1, double c2, double c11, double c12, double c22) {
+		c[0] = c0; c[1] = c1; c[2] = c2; c[3] = c11; c[4] = c12; c[5] = c22;
+	};
+	double operator()(double alpha1, double alpha2) const {
+		return c[0]+alpha1*(c[1]+c[3]*alpha1+c[4]*alpha2)+alpha2*(c[2]+c[5]*alpha2);
+	};
+	alpha_quadratic& operator+=(const alpha_quadratic& o) {for (int k = 0; k < 6; k++) c[k] += o.c[k]; return *this;};
+	alpha_quadratic operator+(const alpha_quadratic& o) const {alpha_quadratic r = *this; return r += o;};
+	alpha_quadratic operator-(const alpha_quadratic& o) const {alpha_quadratic r = *this; for (int k = 0; k < 6; k++) r.c[k] -= o.c[k]; return r;};
+	alpha_quadratic operator*(double v) const {alpha_quadratic r = *this; for (int k = 0; k < 6; k++) r.c[k] *= v; return r;};
+	alpha_quadratic operator/(double v) const {alpha_quadratic r = *this; for (int k = 0; k < 6; k++) r.c[k] /= v; return r;};
+};
+
+//cbp_wf_r_integrand as a quadratic in alpha1 and alpha2, so log_girsanov_wf_r can be had for any
+//of them from one pass over the path. With u = sin x (alpha2+(2alpha1-alpha2)cos x)
+//    a2 = N/16 u^2 - u/(4 tan x) + 1/(4 N tan^2 x) - 1/(4 x^2 N)
+class cbp_wf_r_quadratic_integrand {
+public:
+	static const bool time_dependent = true;
+	static const bool check_ends = false;
+	alpha_quadratic H(double x, double t, double N) {
+		if (x == 0) {
+			return alpha_quadratic(0, -N/4.0, -N/8.0, 0, 0, 0);
+		} else {
+			double c = cos(x);
+			return alpha_quadratic(log(x)/2.0-log(sin(x))/2.0, -N/4.0*c*c, -N/8.0*(2*c-c*c), 0, 0, 0);
+		}
+	};
+	alpha_quadratic a2(double x, double t, double N) {
+		if (x == 0) {
+			return alpha_quadratic(-1.0/(6.0*N), -1.0/2.0, 0, 0, 0, 0);
+		} else {
+			double s = sin(x);
+			double c = cos(x);
+			double cot = 1/tan(x);
+			double A = 2*s*c; //u = alpha1 A + alpha2 B
+			double B = s*(1-c);
+			return alpha_quadratic(cot*cot/(4.0*N)-1.0/(4.0*x*x*N), -A*cot/4.0, -B*cot/4.0, N/16.0*A*A, N/8.0*A*B, N/16.0*B*B);
+		}
+	};
+	alpha_quadratic dadx(double x, double t, double N) {
+		if (x == 0) {
+			return alpha_quadratic(1.0/(6.0*N), 1.0/2.0, 0, 0, 0, 0);
+		} else {
+			double s = sin(x);
+			return alpha_quadratic(1.0/(2.0*s*s*N)-1.0/(2.0*x*x*N), cos(x)/2.0, 0, 0, 0, 0);
+		}
+	};
+	alpha_quadratic dHdt(double x, double t, double dN) {
+		double c = cos(x);
+		return alpha_quadratic(0, -dN/4.0*c*c, -dN/8.0*(2*c-c*c), 0, 0, 0);
+	};
+	bool out_of_bounds(double x) {return x < 0 || x >= PI;};
+};
+
+#endif
@@ -29,6 +29,7 @@
 #include "gzstream.h"
 #include <iostream>
 #include <string.h>  // for memcpy
+#include <thread>
 
 #ifdef GZSTREAM_NAMESPACE
 namespace GZSTREAM_NAMESPACE {
@@ -42,6 +43,59 @@ namespace GZSTREAM_NAMESPACE {
 // class gzstreambuf:
 // --------------------------------------
 
+void gzstreambuf::reset_pointers() {
+    setp( buffer, buffer + (bufferSize-1));
+    setg( buffer + 4,     // beginning of putback area
+          buffer + 4,     // read position
+          buffer + 4);    // end position
+}
+
+void gzstreambuf::set_buffer_size( int n) {
+    if ( is_open() || n < defaultBufferSize)
+        return;
+    delete[] buffer;
+    bufferSize = n;
+    buffer = new char[bufferSize];
+    reset_pointers();
+}
+
+// compresses one buffer into a complete gzip member
+static void deflate_block( const std::vector<char>* in, std::vector<char>* out, int level) {
+    z_stream strm;
+    memset( &strm, 0, sizeof(strm));
+    // 15+16: largest window, with a gzip header and trailer
+    if ( deflateInit2( &strm, level, Z_DEFLATED, 15+16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        out->resize(0);
+        return;
+    }
+    out->resize( deflateBound( &strm, in->size()));
+    strm.next_in = (Bytef*)&(*in)[0];
+    strm.avail_in = in->size();
+    strm.next_out = (Bytef*)&(*out)[0];
+    strm.avail_out = out->size();
+    deflate( &strm, Z_FINISH);
+    out->resize( strm.total_out);
+    deflateEnd( &strm);
+}
+
+int gzstreambuf::compress_pending() {
+    std::vector<std::vector<char> > out( pending.size());
+    std::vector<std::thread> workers;
+    for ( int i = 1; i < pending.size(); i++)
+        workers.push_back( std::thread( deflate_block, &pending[i], &out[i], level));
+    if ( pending.size() > 0)
+        deflate_block( &pending[0], &out[0], level);
+    for ( int i = 0; i < workers.size(); i++)
+        workers[i].join();
+    int ok = 1;
+    for ( int i = 0; i < out.size(); i++) {
+        if ( out[i].size() == 0 || fwrite( &out[i][0], 1, out[i].size(), raw) != out[i].size())
+            ok = 0;
+    }
+    pending.resize(0);
+    return ok ? 0 : EOF;
+}
+
 gzstreambuf* gzstreambuf::open( const char* name, int open_mode) {
     if ( is_open())
         return (gzstreambuf*)0;
@@ -57,16 +111,36 @@ gzstreambuf* gzstreambuf::open( const char* name, int open_mode) {
     else if ( mode & std::ios::out)
         *fmodeptr++ = 'w';
     *fmodeptr++ = 'b';
+    if ( (mode & std::ios::out) && level >= 0 && level <= 9)
+        *fmodeptr++ = '0' + level;
     *fmodeptr = '\0';
+    if ( (mode & std::ios::out) && threads > 1) {
+        raw = fopen( name, "wb");
+        if (raw == 0)
+            return (gzstreambuf*)0;
+        opened = 1;
+        return this;
+    }
     file = gzopen( name, fmode);
     if (file == 0)
         return (gzstreambuf*)0;
+    if ( bufferSize > defaultBufferSize)
+        gzbuffer( file, bufferSize);
     opened = 1;
     return this;
 }
 
 gzstreambuf * gzstreambuf::close() {
     if ( is_open()) {
+        if ( raw) {
+            int ok = ( flush_buffer() != EOF && compress_pending() != EOF);
+            opened = 0;
+            ok = ( fclose( raw) == 0) && ok;
+            raw = 0;
+            if ( ok)
+                return this;
+            return (gzstreambuf*)0;
+        }
         sync();
         opened = 0;
         if ( gzclose( file) == Z_OK)
@@ -104,6 +178,16 @@ int gzstreambuf::flush_buffer() {
     // Separate the writing of the buffer from overflow() and
     // sync() operation.
     int w = pptr() - pbase();
+    if ( raw) {
+        // hand the buffer to the next batch of compression threads
+        if ( w > 0) {
+            pending.push_back( std::vector<char>( pbase(), pptr()));
+            pbump( -w);
+        }
+        if ( pending.size() >= threads && compress_pending() == EOF)
+            return EOF;
+        return w;
+    }
     if ( gzwrite( file, pbase(), w) != w)
         return EOF;
     pbump( -w);
@@ -126,6 +210,10 @@ int gzstreambuf::sync() {
     // Changed to use flush_buffer() instead of overflow( EOF)
     // which caused improper behavior with std::endl and flush(),
     // bug reported by Vincent Ricard.
+    // In parallel mode a flush would end a gzip member every line, so data
+    // waits until the buffer is full or the file is closed.
+    if ( raw)
+        return 0;
     if ( pptr() && pptr() > pbase()) {
         if ( flush_buffer() == EOF)
             return -1;
@@ -32,6 +32,8 @@
 // standard C++ with new header file names and std:: namespace
 #include <iostream>
 #include <fstream>
+#include <vector>
+#include <cstdio>
 #include <zlib.h>
 
 #ifdef GZSTREAM_NAMESPACE
@@ -44,27 +46,44 @@ namespace GZSTREAM_NAMESPACE {
 
 class gzstreambuf : public std::streambuf {
 private:
-    static const int bufferSize = 47+256;    // size of data buff
+    static const int defaultBufferSize = 47+256;    // size of data buff
     // totals 512 bytes under g++ for igzstream at the end.
 
     gzFile           file;               // file handle for compressed file
-    char             buffer[bufferSize]; // data buffer
+    char*            buffer;             // data buffer
+    int              bufferSize;
     char             opened;             // open/close state of stream
     int              mode;               // I/O mode
+    int              level;              // compression level, Z_DEFAULT_COMPRESSION unless set
+    int              threads;            // > 1: compress whole buffers in parallel
+
+    // parallel mode: each full buffer becomes its own gzip member, written
+    // straight to raw. Concatenated members are still a valid gzip file.
+    FILE*            raw;
+    std::vector<std::vector<char> > pending; // full buffers waiting to be compressed
 
     int flush_buffer();
+    int compress_pending();
+    void reset_pointers();
 public:
     gzstreambuf() : opened(0) {
-        setp( buffer, buffer + (bufferSize-1));
-        setg( buffer + 4,     // beginning of putback area
-              buffer + 4,     // read position
-              buffer + 4);    // end position      
+        bufferSize = defaultBufferSize;
+        buffer = new char[bufferSize];
+        level = Z_DEFAULT_COMPRESSION;
+        threads = 1;
+        raw = 0;
+        reset_pointers();
         // ASSERT: both input & output capabilities will not be used together
     }
     int is_open() { return opened; }
     gzstreambuf* open( const char* name, int open_mode);
     gzstreambuf* close();
-    ~gzstreambuf() { close(); }
+    ~gzstreambuf() { close(); delete[] buffer; }
+    
+    // these only take effect if called before open()
+    void set_buffer_size( int n);
+    void set_level( int l) { level = l; }
+    void set_threads( int t) { threads = (t < 1) ? 1 : t; }
     
     virtual int     overflow( int c = EOF);
     virtual int     underflow();
@@ -98,6 +117,8 @@ public:
     void open( const char* name, int open_mode = std::ios::in) {
         gzstreambase::open( name, open_mode);
     }
+    // bytes read from the file at a time; call before open()
+    void set_buffer_size( int n) { buf.set_buffer_size( n); }
 };
 
 class ogzstream : public gzstreambase, public std::ostream {
@@ -109,6 +130,13 @@ public:
     void open( const char* name, int open_mode = std::ios::out) {
         gzstreambase::open( name, open_mode);
     }
+    // buffer size in bytes, compression level 0-9 and number of compression threads;
+    // call before open()
+    void set_options( int buffer_size, int level, int threads) {
+        buf.set_buffer_size( buffer_size);
+        buf.set_level( level);
+        buf.set_threads( threads);
+    }
 };
 
 #ifdef GZSTREAM_NAMESPACE
@@ -5,6 +5,11 @@
 #include "settings.h"
 #include "mcmc.h"
 #include "popsize.h"
+#include "output.h"
+#include "bridges.h"
+#include "simulate.h"
+#include "surface.h"
+#include "reweight.h"
 
 int main (int argc, char * const argv[]) {
 	
@@ -16,7 +21,11 @@ int main (int argc, char * const argv[]) {
 		mySettings.print();
 	}
 	
-	if (mySettings.get_bridge()) {
+	if (mySettings.get_simulate()) {
+		simulate_data(mySettings, r);
+	} else if (mySettings.get_bridge() && mySettings.get_num_bridges() > 0) {
+		make_bridges(mySettings, r);
+	} else if (mySettings.get_bridge()) {
 		wfMeasure myWF(r,0);
 		std::vector<double> pars = mySettings.parse_bridge_pars();
         std::cerr << "Creating bridge with (x0, xt, gamma, t) = (" << pars[0] << ", " << pars[1]
@@ -31,15 +40,31 @@ int main (int argc, char * const argv[]) {
 			myPath->print(std::cout);
 		}
 		delete myPath;
+	} else if (mySettings.get_reweight()) {
+		reweight_run(mySettings);
+	} else if (mySettings.get_surface() && mySettings.get_surface_input() != "") {
+		surface_from_run(mySettings);
 	} else if (mySettings.get_mcmc()) {
 		if (mySettings.get_linked()) {
 			
 		} else {
 			mcmc myMCMC(mySettings,r);
+			file_sink output(mySettings);
+			myMCMC.add_sink(&output);
+			surface_sink* surface = NULL;
+			if (mySettings.get_surface()) {
+				surface = new surface_sink(mySettings);
+				myMCMC.add_sink(surface);
+			}
+			myMCMC.run();
+			delete surface;
 		}
 	} else {
 		std::cout << "No task specified" << std::endl;
 		std::cout << "-b x0,xt,gamma,t for bridge path" << std::endl;
+		std::cout << "-S alpha1,alpha2,age,replicates[,F] with -D and -P to simulate data sets" << std::endl;
+		std::cout << "-L a1start,a1end,a1points,a2start,a2end,a2points[,burnin] -I output_prefix for a likelihood surface from an earlier run" << std::endl;
+		std::cout << "-V old_popsize_file -I output_prefix to reweight an earlier run to the -P history and -C prior scale" << std::endl;
 		std::cout << "-X x0,x1,...,xn -N n0,n1,...nn -T t0,t1,...tn for mcmc with just allele frequencies" << std::endl;
 	}
 		
@@ -13,55 +13,84 @@
 #include "path.h"
 #include "measure.h"
 #include "param.h"
+#include "runpaths.h"
 
+#include<algorithm>
 #include<iomanip>
 #include<fstream>
+#include<sstream>
 
 mcmc::mcmc(settings& mySettings, MbRandom* r) {
 	random = r;
+	popsize* myPop = mySettings.parse_popsize_file();
+	sample_time_vec = mySettings.parse_input_file(random);
+	setup(mySettings, myPop);
+}
+
+mcmc::mcmc(settings& mySettings, MbRandom* r, popsize* myPop, std::vector<sample_time*>& samples) {
+	random = r;
+	sample_time_vec = samples;
+	setup(mySettings, myPop);
+}
+
+mcmc::~mcmc() {
+	//the sample times that are parameters are deleted with the rest of sample_time_vec
+	for (int i = 0; i < pars.size(); i++) {
+		bool is_sample = false;
+		for (int j = 0; j < sample_time_vec.size(); j++) {
+			if (pars[i] == sample_time_vec[j]) {
+				is_sample = true;
+			}
+		}
+		if (!is_sample) {
+			delete pars[i];
+		}
+	}
+	for (int i = 0; i < sample_time_vec.size(); i++) {
+		delete sample_time_vec[i];
+	}
+}
+
+void mcmc::setup(settings& mySettings, popsize* myPop) {
 	printFreq = mySettings.get_printFreq();
 	sampleFreq = mySettings.get_sampleFreq();
 	num_gen = mySettings.get_num_gen();
 	minUpdate = mySettings.getMinUpdate();
-	if (!mySettings.get_linked()) {
-		no_linked_sites(mySettings);
-	} else {
-		
-	}
-}
-
-void mcmc::no_linked_sites(settings& mySettings) {
-	//open files
-	std::string paramName = mySettings.get_baseName() + ".param.gz";
-	std::string trajName = mySettings.get_baseName() + ".traj.gz";
-	std::string timeName = mySettings.get_baseName() + ".time.gz";
-	paramFile.open(paramName.c_str());
-	trajFile.open(trajName.c_str());
-	timeFile.open(timeName.c_str());
+	fix_h = mySettings.get_fix_h();
+	h = mySettings.get_h();
+	path_error = mySettings.get_path_error();
+	coarse_diff_sum = 0;
+	coarse_diff_max = 0;
+	coarse_diff_count = 0;
+	gen = 0;
+	finished = false;
 	
 	//initialize wfMeasure
 	wfMeasure* curWF = new wfMeasure(random,0);
 	//wfMeasure* oldWF = NULL;
 	curWF->set_num_test(mySettings.get_num_test());
 		    
-    //parse the settings
-    popsize* myPop = mySettings.parse_popsize_file();
-    std::vector<sample_time*> sample_time_vec = mySettings.parse_input_file(random);
-    
     //initialize path
     curPath = new wfSamplePath(sample_time_vec, myPop, curWF, mySettings, random);
+    
+    double a1start = mySettings.get_a1start();
+    double a2start = mySettings.get_a2start();
+    double Fstart = 0.1;
+    if (mySettings.get_init_from() != "") {
+        warm_start(mySettings, a1start, a2start, Fstart);
+    }
 	
-	param_gamma* alpha1 = new param_gamma(mySettings.get_a1start(),random);
+	param_gamma* alpha1 = new param_gamma(a1start,random,mySettings.get_alpha_prior());
 	
-	param_gamma* alpha2 = new param_gamma(mySettings.get_a2start(),random);
+	param_gamma* alpha2 = new param_gamma(a2start,random,mySettings.get_alpha_prior());
 	
-	param_path* curParamPath = new param_path(curPath,alpha1,alpha2,random,mySettings);
+	param_path* curParamPath = new param_path(curPath,alpha1,alpha2,random,mySettings,&scratch);
     
-    param_F* cur_F = new param_F(0.1,random);
+    param_F* cur_F = new param_F(Fstart,random);
     curPath->set_F(cur_F);
     
-    start_freq* start;
-    param_age* age;
+    start_freq* start = NULL;
+    param_age* age = NULL;
     if (!mySettings.get_infer_age()) {
         start = new start_freq(curPath->get_traj(0),random,curParamPath);
     } else {
@@ -108,7 +137,7 @@ void mcmc::no_linked_sites(settings& mySettings) {
     
 	//initialize the proposal ratios
 	//probably move this somewhere else
-	std::vector<double> propChance(0);
+	propChance.resize(0);
 	propChance.push_back(mySettings.get_a1prop()); //update alpha1
 	propChance.push_back(mySettings.get_a2prop()); //update alpha2
     propChance.push_back(mySettings.get_fprop()); //update F
@@ -132,6 +161,7 @@ void mcmc::no_linked_sites(settings& mySettings) {
     
     //determine if ascertained
     doAscertain = mySettings.get_ascertain();
+    curPath->set_ascertain(doAscertain);
     
     if (doAscertain) {
         double ssModern = sample_time_vec[sample_time_vec.size()-1]->get_ss();
@@ -146,10 +176,120 @@ void mcmc::no_linked_sites(settings& mySettings) {
 	
 	//compute starting lnL
 	curlnL = compute_lnL_sample_only(curPath);
+	curPath->commitSampleLogLik();
+}
+
+void mcmc::warm_start(settings& mySettings, double& a1, double& a2, double& F) {
+    std::string baseName = mySettings.get_init_from();
+    int init_gen = mySettings.get_init_gen();
+    param_reader params;
+    run_traj_reader trajs;
+    open_run(baseName, params, trajs);
     
-	//run mcmc
-	for (gen = 0; gen < num_gen; gen++) {
+    //find the sample to start from
+    int gen;
+    int traj_gen;
+    int found = -1;
+    std::vector<double> values;
+    std::vector<double> freq;
+    std::vector<double> time;
+    std::vector<double> init_values;
+    std::vector<double> init_freq;
+    std::vector<double> init_time;
+    while (params.next(gen, values)) {
+        if (!trajs.next(traj_gen, freq, time) || traj_gen != gen) {
+            check_run(params, trajs);
+            std::cerr << "ERROR: The trajectories of " << baseName << " don't match the parameters at generation " << gen << std::endl;
+            exit(1);
+        }
+        if (init_gen == -1 || gen == init_gen) {
+            found = gen;
+            init_values.swap(values);
+            init_freq.swap(freq);
+            init_time.swap(time);
+        }
+        if (gen == init_gen) {
+            break;
+        }
+    }
+    check_run(params, trajs);
+    if (found == -1) {
+        std::cerr << "ERROR: " << baseName << " has no sample ";
+        if (init_gen != -1) {
+            std::cerr << "at generation " << init_gen;
+        }
+        std::cerr << std::endl;
+        exit(1);
+    }
+    if (init_time.size() < 2) {
+        std::cerr << "ERROR: The trajectory of generation " << found << " of " << baseName << " is too short to start from" << std::endl;
+        exit(1);
+    }
+    
+    int alpha1_col = params.find_column("alpha1");
+    int alpha2_col = params.find_column("alpha2");
+    int F_col = params.find_column("F");
+    if (alpha1_col < 0 || alpha2_col < 0 || F_col < 0) {
+        std::cerr << "ERROR: " << baseName << ".param.gz has no alpha1, alpha2 and F columns" << std::endl;
+        exit(1);
+    }
+    a1 = init_values[alpha1_col];
+    a2 = init_values[alpha2_col];
+    F = init_values[F_col];
+    
+    //uncertain sample times
+    for (int i = 0; i < sample_time_vec.size(); i++) {
+        std::ostringstream name;
+        name << "sample_time_" << i;
+        int col = params.find_column(name.str());
+        if (col < 0 || sample_time_vec[i]->get_oldest() == sample_time_vec[i]->get_youngest()) {
+            continue;
+        }
+        double t = init_values[col];
+        if (t < sample_time_vec[i]->get_oldest() || t > sample_time_vec[i]->get_youngest()) {
+            std::cerr << "ERROR: Sample time " << i << " of " << baseName << " is outside of its range in this data set" << std::endl;
+            exit(1);
+        }
+        sample_time_vec[i]->setNew(t);
+        sample_time_vec[i]->setOld(t);
+    }
+    
+    //the path, starting from the allele age if it's inferred and from where it already starts if not
+    for (int i = 0; i < init_freq.size(); i++) {
+        init_freq[i] = acos(1.0-2.0*init_freq[i]);
+    }
+    double start = mySettings.get_infer_age() ? init_time[0] : curPath->get_time(0);
+    curPath->warm_start(init_freq, init_time, start, mySettings);
+    std::cout << "Starting from generation " << found << " of " << baseName << std::endl;
+}
+
+void mcmc::add_sink(mcmc_sink* s) {
+	sinks.push_back(s);
+	s->start(columns);
+}
+
+void mcmc::run() {
+	step(num_gen-gen);
+	finish();
+}
 
+void mcmc::finish() {
+	if (finished) {
+		return;
+	}
+	finished = true;
+	if (path_error && coarse_diff_count > 0) {
+		std::cout << "Change in pathlnL on a grid twice as coarse: mean " << coarse_diff_sum/coarse_diff_count << ", largest " << coarse_diff_max << std::endl;
+	}
+	for (int i = 0; i < sinks.size(); i++) {
+		sinks[i]->finish();
+	}
+}
+
+void mcmc::step(int n) {
+	for (int end = gen+n; gen < end; gen++) {
+
+		scratch.reset();
 		std::string state;
 		double propRatio = 0;
 		double priorRatio = 0;
@@ -166,8 +306,8 @@ void mcmc::no_linked_sites(settings& mySettings) {
 		propRatio = pars[curProp]->propose();
 		priorRatio = pars[curProp]->prior();
         
-        if (mySettings.get_fix_h() && curProp == 1) {
-            pars[0]->setNew(pars[1]->get()*mySettings.get_h());
+        if (fix_h && curProp == 1) {
+            pars[0]->setNew(pars[1]->get()*h);
         }
 		
         //TODO: DOES THIS DO ANYTHING??????
@@ -209,6 +349,7 @@ void mcmc::no_linked_sites(settings& mySettings) {
 			}
 			curPath->set_update_begin(0);
 			curPath->set_old_index(-1);
+			curPath->commitSampleLogLik();
 			//delete oldWF;
 			state = "Accept";
 		} else {
@@ -217,12 +358,13 @@ void mcmc::no_linked_sites(settings& mySettings) {
 				pars[curProp]->reset();
 			}
             
-            if (mySettings.get_fix_h() && curProp == 1) {
+            if (fix_h && curProp == 1) {
                 pars[0]->reset();
             }
 			
 			//delete curWF;
 			//curWF = oldWF;
+			curPath->rollbackSampleLogLik();
 			curlnL = oldlnL;
 			state = "Reject";
 		}
@@ -235,7 +377,7 @@ void mcmc::no_linked_sites(settings& mySettings) {
         
         for (int i = 0; i < sample_time_vec.size(); i++) {
             double curTime = sample_time_vec[i]->get();
-            int curIdx = sample_time_vec[i]->get_idx();
+            int curIdx = curPath->get_sampleTime(i);
             if (curIdx != -1) {
                 double curTimePath = curPath->get_time(curIdx);
                 if (curTime != curTimePath && curIdx != -1) {
@@ -266,11 +408,6 @@ void mcmc::no_linked_sites(settings& mySettings) {
 		}
 
 	}
-    paramFile.close();
-    trajFile.close();
-    timeFile.close();
-   
-
 }
 
 //for now, this computes the lnL of the WHOLE PATH (wrt Wiener measure) and SAMPLES
@@ -279,10 +416,7 @@ double mcmc::compute_lnL(wfSamplePath* p, measure* m, wienerMeasure* wm) {
 	//compute dP/dW
 	double gir = wm->log_girsanov(p, m, 0, PI);
 	//compute sampling probs
-	double sample_prob = 0;
-	for (int i = 0; i < p->get_num_samples(); i++) {
-		sample_prob += p->sampleProb(i);
-	}
+	double sample_prob = p->sampleLogLik();
 	
 	if (isnan(gir)) {
 		std::cerr << "ERROR: Likelihood is NaN at generation " << gen << ". Proposal " << curProp << std::endl;
@@ -294,10 +428,7 @@ double mcmc::compute_lnL(wfSamplePath* p, measure* m, wienerMeasure* wm) {
 }
 
 double mcmc::compute_lnL_sample_only(wfSamplePath* p) {
-	double sample_prob = 0;
-	for (int i = 0; i < p->get_num_samples(); i++) {
-		sample_prob += p->sampleProb(i);
-	}
+	double sample_prob = p->sampleLogLik();
     
     if (sample_prob == -INFINITY) {
         return -INFINITY;
@@ -318,32 +449,50 @@ double mcmc::ascertain(wfSamplePath* p) {
 }
 
 void mcmc::prepareOutput(bool infer_age, std::vector<int> time_idx) {
-    paramFile << "gen\tlnL\tpathlnL\talpha1\talpha2\tF";
+    columns.resize(0);
+    columns.push_back("lnL");
+    columns.push_back("pathlnL");
+    columns.push_back("alpha1");
+    columns.push_back("alpha2");
+    columns.push_back("F");
     if (infer_age) {
-        paramFile << "\tage";
+        columns.push_back("age");
     } else {
-        paramFile << "\tstart_freq";
+        columns.push_back("start_freq");
     }
-    paramFile << "\tend_freq";
+    columns.push_back("end_freq");
     for (int i = 0; i < time_idx.size(); i++) {
-        paramFile << "\tsample_time_" << time_idx[i];
+        std::ostringstream name;
+        name << "sample_time_" << time_idx[i];
+        columns.push_back(name.str());
+    }
+    columns.push_back("first_nonzero");
+    if (path_error) {
+        columns.push_back("pathlnL_coarse_diff");
     }
-    paramFile << "\tfirst_nonzero";
-    paramFile << std::endl;
 }
 
 void mcmc::printState() {
+    if (sinks.size() == 0) {
+        return;
+    }
     cbpMeasure testCBP(random);
     double pathlnL = testCBP.log_girsanov_wf_r(curPath, pars[0]->get(), pars[1]->get(), curPath->get_pop(), 0);
-    paramFile << gen << "\t" << curlnL << "\t" << pathlnL;
+    values.resize(0);
+    values.push_back(curlnL);
+    values.push_back(pathlnL);
     for (int i = 0; i < pars.size()-1; i++) {
-        paramFile << "\t" << pars[i]->get();
+        values.push_back(pars[i]->get());
+    }
+    values.push_back(curPath->get_firstNonzero());
+    if (path_error) {
+        double diff = testCBP.log_girsanov_wf_r_coarse_diff(curPath, pars[0]->get(), pars[1]->get(), curPath->get_pop());
+        values.push_back(diff);
+        coarse_diff_sum += diff;
+        coarse_diff_max = std::max(coarse_diff_max, diff);
+        coarse_diff_count++;
+    }
+    for (int i = 0; i < sinks.size(); i++) {
+        sinks[i]->sample(gen, values, curPath);
     }
-    paramFile << "\t" << curPath->get_firstNonzero();
-    paramFile << std::endl;
-    trajFile << gen << " ";
-    curPath->print_traj(trajFile << std::setprecision(6));
-    timeFile << gen << " ";
-    curPath->print_time(timeFile << std::setprecision(6));
 }
-
@@ -9,9 +9,11 @@
 
 #pragma once
 
-#include "gzstream.h"
+#include "output.h"
+#include "arena.h"
 #include <fstream>
 #include <vector>
+#include <string>
 
 class wfSamplePath;
 class measure;
@@ -20,27 +22,53 @@ class MbRandom;
 class settings;
 class param;
 class sample_time;
+class popsize;
 
+//One chain. Constructing it sets everything up (the initial path, the parameters and the
+//starting likelihood) without running anything; step() and run() do the generations. What
+//happens to the samples is up to the sinks, every sampleFreq (-s) generations each of them gets
+//the values on a line of the param file and the path. sr itself adds a file_sink, for its
+//usual output files.
 class mcmc {
 
 public:
-	mcmc(settings& mySettings, MbRandom* r);
+	mcmc(settings& mySettings, MbRandom* r); //reads the data and population size history named in mySettings
+	mcmc(settings& mySettings, MbRandom* r, popsize* myPop, std::vector<sample_time*>& sample_time_vec); //takes ownership of myPop and the samples; popsize can be copied, to reuse a parsed history
+	~mcmc();
+
+	void add_sink(mcmc_sink* s); //not owned, must outlive the chain or finish()
+	void step(int n = 1); //runs n more generations
+	void run(); //runs the generations that are left of num_gen (-n), then finish()
+	void finish(); //tells the sinks there are no more samples
+
+	//state of the chain
+	int get_gen() {return gen;}; //generations done so far
+	double get_lnL() {return curlnL;};
+	wfSamplePath* get_path() {return curPath;};
+	std::vector<std::string>& get_columns() {return columns;}; //names of the values the sinks get
+	int get_num_pars() {return pars.size();}; //the path is the last one
+	param* get_par(int i) {return pars[i];};
 	
 private:
 	//variables to store
 	double curlnL; 
 	double oldlnL;
     std::vector<param*> pars;
+    std::vector<double> propChance; //cdf of the proposal chances of pars
     wfSamplePath* curPath;
+    std::vector<sample_time*> sample_time_vec;
 
 	
 	MbRandom* random;
+	path_arena scratch; //temporary paths for the proposals, recycled every generation
 	int num_gen;
 	int printFreq;
 	int sampleFreq;
 	int minUpdate;
-	void no_linked_sites(settings& mySettings);
-	void linked_sites(settings& mySettings);
+	bool fix_h;
+	double h;
+	void setup(settings& mySettings, popsize* myPop);
+	void warm_start(settings& mySettings, double& a1, double& a2, double& F); //-i: the path and the sample times from an earlier run, and its alpha1, alpha2 and F into a1, a2 and F
 	
 	//for computing things
 	double compute_lnL(wfSamplePath* p, measure* m, wienerMeasure* wm);
@@ -52,10 +80,11 @@ private:
 	int gen;
 	int curProp;
     
-    // gzip output files
-    ogzstream paramFile;
-    ogzstream trajFile;
-    ogzstream timeFile;
+    //where the samples go
+    std::vector<mcmc_sink*> sinks;
+    std::vector<std::string> columns;
+    std::vector<double> values; //the line of the param file, handed to the sinks
+    bool finished;
     
     //output functions
     void prepareOutput(bool infer_age, std::vector<int> time_idx);
@@ -63,4 +92,10 @@ private:
 	
     bool doAscertain;
     int minCount; 
-};
\ No newline at end of file
+    
+    //-Y: how much pathlnL changes on a grid twice as coarse, over the samples
+    bool path_error;
+    double coarse_diff_sum;
+    double coarse_diff_max;
+    int coarse_diff_count;
+};
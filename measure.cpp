@@ -16,70 +16,69 @@
 #include "path.h"
 #include "MbRandom.h"
 #include "popsize.h"
+#include "arena.h"
+#include "girsanov.h"
 
 measure::measure(MbRandom* r) {
 	random = r;
+	arena = NULL;
+}
+
+path* measure::new_path() {
+	if (arena != NULL) {
+		return arena->get_path();
+	}
+	return new path();
+}
+
+void measure::free_path(path* p) {
+	if (arena == NULL) {
+		delete p;
+	}
 }
 
 wfMeasure::wfMeasure(MbRandom* r, double g) : measure(r) {
 	gamma = g;
 	num_test = 0;
+	tries = 0;
+}
+
+//the integrals for any measure, skipping the virtual calls if it's a wfMeasure
+static bool integrate_measure(path* p, measure* m, double lower, double upper, girsanov_sums& s) {
+	no_demography rho;
+	wfMeasure* wf = dynamic_cast<wfMeasure*>(m);
+	if (wf != NULL) {
+		wf_integrand f(wf, lower, upper);
+		return integrate_girsanov(p, f, rho, s);
+	}
+	measure_integrand f(m, lower, upper);
+	return integrate_girsanov(p, f, rho, s);
 }
 
 //uses Ito's formula to avoid computing an Ito integral
 double measure::log_girsanov(path* p, measure* m,double lower, double upper, bool is_bridge) {
-	int i;
 	int path_len = p->get_length();
 	double x0 = p->get_traj(0);
 	double xt = p->get_traj(path_len - 1);
 	double t0 = p->get_time(0);
 	double tt = p->get_time(path_len -1); 
 	
-	//check if the path is in the bounds
-	for (i = 0; i < path_len; i++) {
-		if (p->get_traj(i) < lower || p->get_traj(i) > upper) {
-			return -INFINITY;
-		}
-	}
-	
-	//compute everything for current measure (dominating measure)
-	double H_wt = H(xt,tt);
-	double H_w0 = H(x0,t0);
-	//compute the time integral of the derivative
-	double int_deriv = 0;
-	for (i = 1; i < path_len; i++) {
-		//use trapezoid rule: average the values at t_i, t_{i-1}
-		int_deriv += (dadx(p->get_traj(i),p->get_time(i))+dadx(p->get_traj(i-1),p->get_time(i-1)))/2.0
-					* (p->get_time(i)-p->get_time(i-1));
-	}
-	//compute the time integral of the square
-	double int_square = 0;
-	for (i = 1; i < path_len; i++) {
-		int_square += (pow(a(p->get_traj(i),p->get_time(i)),2)+pow(a(p->get_traj(i-1),p->get_time(i-1)),2))/2.0
-		              * (p->get_time(i)-p->get_time(i-1));
+	//check if the path is in the bounds; the integrals check the rest of it
+	if (x0 < lower || x0 > upper) {
+		return -INFINITY;
 	}
 	
-	//compute everything for test measure m
-	double Hm_wt = m->H(p->get_traj(path_len-1),p->get_time(path_len-1));
-	double Hm_w0 = m->H(p->get_traj(0), p->get_time(0));
-	//compute the time integral of the derivative
-	double int_mderiv = 0;
-	for (i = 1; i < path_len; i++) {
-		//use trapezoid rule: average the values at t_i, t_{i-1}
-		int_mderiv += (m->dadx(p->get_traj(i),p->get_time(i))+m->dadx(p->get_traj(i-1),p->get_time(i-1)))/2.0
-		* (p->get_time(i)-p->get_time(i-1));
-	}
-	//compute the time integral of the square
-	double int_msquare = 0;
-	for (i = 1; i < path_len; i++) {
-		int_msquare += (pow(m->a(p->get_traj(i),p->get_time(i)),2)+pow(m->a(p->get_traj(i-1),p->get_time(i-1)),2))/2.0
-		* (p->get_time(i)-p->get_time(i-1));
+	//compute everything for current measure (dominating measure), then for test measure m
+	girsanov_sums dom;
+	girsanov_sums test;
+	if (!integrate_measure(p, this, lower, upper, dom) || !integrate_measure(p, m, lower, upper, test)) {
+		return -INFINITY;
 	}
 	
 	if (!is_bridge) {
-		return (Hm_wt-Hm_w0-1.0/2.0*int_mderiv-1.0/2.0*int_msquare)-(H_wt-H_w0-1.0/2.0*int_deriv-1.0/2.0*int_square);
+		return test.log_ratio()-dom.log_ratio();
 	} else {
-		double gir = (Hm_wt-Hm_w0-1.0/2.0*int_mderiv-1.0/2.0*int_msquare)-(H_wt-H_w0-1.0/2.0*int_deriv-1.0/2.0*int_square);
+		double gir = test.log_ratio()-dom.log_ratio();
 		//Computes the factors necessary for conditioning. NB: dominating measure ON TOP.
 		double cond = log_transition_density(x0, xt, tt-t0)-m->log_transition_density(x0, xt, tt-t0);
 		return gir + cond;
@@ -88,7 +87,6 @@ double measure::log_girsanov(path* p, measure* m,double lower, double upper, boo
 
 //log girsanov for wiener measure; don't waste time computing the stuff for the wiener measure
 double wienerMeasure::log_girsanov(path* p, measure* m, double lower, double upper, bool is_bridge) {
-	int i;
 	int path_len = p->get_length();
 	double x0 = p->get_traj(0);
 	double xt = p->get_traj(path_len - 1);
@@ -96,37 +94,21 @@ double wienerMeasure::log_girsanov(path* p, measure* m, double lower, double upp
 	double tt = p->get_time(path_len -1);
 		
 	//compute everything for test measure m
-	double Hm_wt = m->H(xt,tt);
-	double Hm_w0 = m->H(x0, t0);
-	//compute the time integral of the derivative
-	double int_mderiv = 0;
-	for (i = 1; i < path_len; i++) {
-		//also check if legal
-		if (p->get_traj(i) < lower || p->get_traj(i) > upper) {
-			return -INFINITY;
-		}
-		//use trapezoid rule: average the values at t_i, t_{i-1}
-		int_mderiv += (m->dadx(p->get_traj(i),p->get_time(i))+m->dadx(p->get_traj(i-1),p->get_time(i-1)))/2.0
-		* (p->get_time(i)-p->get_time(i-1));
-	}
-	//compute the time integral of the square
-	double int_msquare = 0;
-	for (i = 1; i < path_len; i++) {
-		int_msquare += (pow(m->a(p->get_traj(i),p->get_time(i)),2)+pow(m->a(p->get_traj(i-1),p->get_time(i-1)),2))/2.0
-		* (p->get_time(i)-p->get_time(i-1));
+	girsanov_sums test;
+	if (!integrate_measure(p, m, lower, upper, test)) {
+		return -INFINITY;
 	}
 		
 	if (!is_bridge) {
-		return (Hm_wt-Hm_w0-1.0/2.0*int_mderiv-1.0/2.0*int_msquare);
+		return test.log_ratio();
 	} else {
-		double gir = (Hm_wt-Hm_w0-1.0/2.0*int_mderiv-1.0/2.0*int_msquare);
+		double gir = test.log_ratio();
 		double cond = -m->log_transition_density(x0, xt, tt-t0) + log_transition_density(x0, xt, tt-t0);
 		return gir + cond;
 	}
 }
 
 double cbpMeasure::log_girsanov_wf(path* p, double alpha, bool is_bridge) {
-	int i;
 	int path_len = p->get_length();
 	double x0 = p->get_traj(0);
 	double xt = p->get_traj(path_len - 1);
@@ -134,251 +116,107 @@ double cbpMeasure::log_girsanov_wf(path* p, double alpha, bool is_bridge) {
 	double tt = p->get_time(path_len -1);
 	
 	//compute everything for test measure m
-	double Hm_wt = H_wf(xt,tt,alpha);
-	double Hm_w0 = H_wf(x0, t0,alpha);
-	//compute the time integral of the derivative
-	double int_mderiv = 0;
-	for (i = 1; i < path_len; i++) {
-		//use trapezoid rule: average the values at t_i, t_{i-1}
-		int_mderiv += (dadx_wf(p->get_traj(i),p->get_time(i),alpha)+dadx_wf(p->get_traj(i-1),p->get_time(i-1),alpha))/2.0
-		* (p->get_time(i)-p->get_time(i-1));
-	}
-	//compute the time integral of the square
-	double int_msquare = 0;
-	for (i = 1; i < path_len; i++) {
-		int_msquare += (a2_wf(p->get_traj(i),p->get_time(i),alpha)+a2_wf(p->get_traj(i-1),p->get_time(i-1),alpha))/2.0
-		* (p->get_time(i)-p->get_time(i-1));
-	}
+	cbp_wf_integrand f(this, alpha);
+	no_demography rho;
+	girsanov_sums s;
+	integrate_girsanov(p, f, rho, s);
 	
 	if (!is_bridge) {
-		return (Hm_wt-Hm_w0-1.0/2.0*int_mderiv-1.0/2.0*int_msquare);
+		return s.log_ratio();
 	} else {
-		double gir = (Hm_wt-Hm_w0-1.0/2.0*int_mderiv-1.0/2.0*int_msquare);
+		double gir = s.log_ratio();
 		double cond = log_transition_density(x0, xt, tt-t0);
 		return gir + cond;
 	}
 }
 
 double cbpMeasure::log_girsanov_wf_r(path* p, double alpha1, double alpha2, popsize* rho, bool is_bridge) {
-	int i;
-	int j;
 	int path_len = p->get_length();
 	double x0 = p->get_traj(0);
 	double xt = p->get_traj(path_len - 1);
 	//these are in regular time
 	double t0 = p->get_time(0);
 	double tt = p->get_time(path_len -1);
-	//convert to tau
-	double tau0 = rho->getTau(t0);
-	double taut = rho->getTau(tt);
 	
-	//compute everything for test measure m
-	double Hm_wt = 0;
-	double Hm_w0 = 0;
-
-	//find the relevant breakpoints
-	std::vector<double> dconts = rho->getBreakTimes(t0,tt);
-	
-	if (dconts.size() > 2) {
-		//std::cout << "Crossing boundaries!" << std::endl;
-	}
-	
-	//the derivative time integral
-	double int_mderiv = 0;
-	i = 0;
-	for (j = 0; j < dconts.size()-1; j++) {
-		//get the potentials while I'm at it.
-		//first the "beginning" potential 
-		Hm_w0 += H_wf_r(p->get_traj(i), p->get_time(i), alpha1, alpha2, rho);
-		i++;
-		//integrate over the interval using the trapezoid rule
-		while (p->get_time(i) < dconts[j+1]) {
-            if (p->get_traj(i) < 0 || p->get_traj(i) >= PI) {
-                return -INFINITY; //Make sure the proposed path is stuck in the right space
-            }
-			int_mderiv += (dadx_wf_r(p->get_traj(i),p->get_time(i),alpha1,alpha2,rho)+dadx_wf_r(p->get_traj(i-1),p->get_time(i-1),alpha1,alpha2,rho))/2.0
-			* (p->get_time(i)-p->get_time(i-1));
-			i++;
-		}
-
-		//and the last little bit, where I need a left limit
-		int_mderiv += (dadx_wf_r(p->get_traj(i),p->get_time(i),alpha1,alpha2,rho,1)+dadx_wf_r(p->get_traj(i-1),p->get_time(i-1),alpha1,alpha2,rho))/2.0
-		* (p->get_time(i)-p->get_time(i-1));
-		//then the "end" potential
-        double tmp = H_wf_r(p->get_traj(i), p->get_time(i), alpha1, alpha2, rho, 1);
-        if (isnan(tmp)) {
-            std::cout << "computation of H_wf_r is NaN" << std::endl;
-            std::cout << "p->get_length() = " << p->get_length() << " i = " << i << " j = " << j << std::endl;
-        }
-        Hm_wt += tmp;
-	}
-
-	//compute the time integral of the square
-	double int_msquare = 0;
-	i = 1;
-	for (j = 0; j < dconts.size()-1; j++) {
-		//integrate over the interval using the trapezoid rule
-		while (p->get_time(i) < dconts[j+1]) {
-			int_msquare += (a2_wf_r(p->get_traj(i),p->get_time(i),alpha1,alpha2,rho)+a2_wf_r(p->get_traj(i-1),p->get_time(i-1),alpha1,alpha2,rho))/2.0
-			* (p->get_time(i)-p->get_time(i-1));
-			i++;
-		}
-        //i--;
-        if (i == p->get_length())  {
-            std::cout << "i is wrong" << std::endl;
-            std::cout << "i = " << i << " p->get_length() = " << p->get_length() << std::endl;
-            std::cout << "j = " << j << std::endl;
-            std::cout << "dconts = " << std::endl;
-            for (int k = 0; k < dconts.size(); k++) {
-                std::cout << dconts[k] << " ";
-            }
-            std::cout << std::endl;
-            raise(SIGSEGV);
-        }		//and the last little bit, where I need a left limit
-		int_msquare += (a2_wf_r(p->get_traj(i),p->get_time(i),alpha1,alpha2,rho,1)+a2_wf_r(p->get_traj(i-1),p->get_time(i-1),alpha1,alpha2,rho))/2.0
-		* (p->get_time(i)-p->get_time(i-1));
+	//a single epoch of constant size needs no breakpoints or derivatives
+	cbp_wf_r_integrand f(alpha1, alpha2);
+	girsanov_sums s;
+	bool legal;
+	if (rho->is_constant()) {
+		constant_demography d(rho);
+		legal = integrate_girsanov(p, f, d, s);
+	} else {
+		variable_demography d(rho);
+		legal = integrate_girsanov(p, f, d, s);
 	}
-	
-	//compute the time integral of the time derivative
-	double int_mtime = 0;
-	i = 1;
-	for (j = 0; j < dconts.size()-1; j++) {
-		//integrate over the interval using the trapezoid rule
-		while (p->get_time(i) < dconts[j+1]) {
-			int_mtime += (dHdt_wf_r(p->get_traj(i),p->get_time(i),alpha1,alpha2,rho)+dHdt_wf_r(p->get_traj(i-1),p->get_time(i-1),alpha1,alpha2,rho))/2.0
-			* (p->get_time(i)-p->get_time(i-1));
-			i++;
-		}
-        //and the last little bit, where I need a left limit
-		int_mtime += (dHdt_wf_r(p->get_traj(i),p->get_time(i),alpha1,alpha2,rho,1)+dHdt_wf_r(p->get_traj(i-1),p->get_time(i-1),alpha1,alpha2,rho))/2.0
-		* (p->get_time(i)-p->get_time(i-1));
+	if (!legal) {
+		return -INFINITY; //Make sure the proposed path is stuck in the right space
 	}
 	
+	double gir = s.log_ratio();
 	if (!is_bridge) {
-        double gir = (Hm_wt-Hm_w0-1.0/2.0*int_mderiv-1.0/2.0*int_msquare-int_mtime);
         if (isnan(gir)) {
             std::cerr << "ERROR: log_girsanov_wf_r is NaN" << std::endl;
-            std::cerr << "Hm_wt = " << Hm_wt << " Hm_w0 = " << Hm_w0 << " int_mderiv = " << int_mderiv << " int_msquare = " << int_msquare << " int_mtime = " << int_mtime << std::endl;
+            std::cerr << "Hm_wt = " << s.H_end << " Hm_w0 = " << s.H_start << " int_mderiv = " << s.int_deriv << " int_msquare = " << s.int_square << " int_mtime = " << s.int_time << std::endl;
             exit(1);
         }
         return gir;
 	} else {
-		double gir = (Hm_wt-Hm_w0-1.0/2.0*int_mderiv-1.0/2.0*int_msquare-int_mtime);
+		//convert to tau
+		double tau0 = rho->getTau(t0);
+		double taut = rho->getTau(tt);
 		double cond = log_transition_density(x0, xt, taut-tau0);
 		return gir + cond;
 	}
 }
 
-double cbpMeasure::log_girsanov_wfwf(path* p, double alpha1, double alpha2) {
-	int i;
-	int path_len = p->get_length();
-	double x0 = p->get_traj(0);
-	double xt = p->get_traj(path_len - 1);
-	double t0 = p->get_time(0);
-	double tt = p->get_time(path_len -1);
-	
-	//compute everything for test measure m
-	double Hm_wt = H_wfwf(xt,tt,alpha1,alpha2);
-	double Hm_w0 = H_wfwf(x0, t0,alpha1,alpha2);
-	//compute the time integral of the derivative
-	double int_mderiv = 0;
-	for (i = 1; i < path_len; i++) {
-		//also check if this thing is legal
-		if (p->get_traj(i) < 0 || p->get_traj(i) >= PI) {
-			return -INFINITY;
-		}
-		//use trapezoid rule: average the values at t_i, t_{i-1}
-		int_mderiv += (dadx_wfwf(p->get_traj(i),p->get_time(i),alpha1,alpha2)+dadx_wfwf(p->get_traj(i-1),p->get_time(i-1),alpha1,alpha2))/2.0
-		* (p->get_time(i)-p->get_time(i-1));
-	}
-	//compute the time integral of the square
-	double int_msquare = 0;
-	for (i = 1; i < path_len; i++) {
-		int_msquare += (a2_wfwf(p->get_traj(i),p->get_time(i),alpha1,alpha2)+a2_wfwf(p->get_traj(i-1),p->get_time(i-1),alpha1,alpha2))/2.0
-		* (p->get_time(i)-p->get_time(i-1));
+double cbpMeasure::log_girsanov_wf_r_coarse_diff(path* p, double alpha1, double alpha2, popsize* rho) {
+	std::vector<double> x2;
+	std::vector<double> t2;
+	if (rho->is_constant()) {
+		constant_demography d(rho);
+		every_other_point(p, d, x2, t2);
+	} else {
+		variable_demography d(rho);
+		every_other_point(p, d, x2, t2);
 	}
+	path coarse(x2, t2);
+	//the error of the trapezoid rule on a diffusion path is random, not a smooth function of the
+	//spacing, so there's no Richardson-style correction; the difference is what's reported
+	double fine = log_girsanov_wf_r(p, alpha1, alpha2, rho, 0);
+	return fabs(fine-log_girsanov_wf_r(&coarse, alpha1, alpha2, rho, 0));
+}
 
-	return (Hm_wt-Hm_w0-1.0/2.0*int_mderiv-1.0/2.0*int_msquare);
+double cbpMeasure::log_girsanov_wfwf(path* p, double alpha1, double alpha2) {
+	cbp_wfwf_integrand f(this, alpha1, alpha2);
+	no_demography rho;
+	girsanov_sums s;
+	if (!integrate_girsanov(p, f, rho, s)) {
+		return -INFINITY;
+	}
+	return s.log_ratio();
 }
 
 double cbpMeasure::log_girsanov_wfwf_r(path* p, double alpha1, double alpha1p, double alpha2, double alpha2p, popsize* rho) {
-	int i;
-	int j;
-	int path_len = p->get_length();
-
-	//get times
-	double t0 = p->get_time(0);
-	double tt = p->get_time(path_len -1);
-	//convert to tau
-
-	
-	//compute everything for test measure m
-	double Hm_wt = 0;
-	double Hm_w0 = 0;
-	
-	//find the relevant breakpoints
-	std::vector<double> dconts = rho->getBreakTimes(t0,tt);
-	
-	//the derivative time integral
-	double int_mderiv = 0;
-	i = 0;
-	for (j = 0; j < dconts.size()-1; j++) {
-		//get the potentials while I'm at it.
-		//first the "beginning" potential 
-		Hm_w0 += H_wfwf_r(p->get_traj(i), p->get_time(i), alpha1, alpha1p, alpha2, alpha2p, rho);
-		
-		i++;
-		//integrate over the interval using the trapezoid rule
-		while (p->get_time(i) < dconts[j+1]) {
-            if (p->get_traj(i) < 0 || p->get_traj(i) > PI) {
-                return -INFINITY; //Make sure the proposed path is stuck in the right space
-            }
-			int_mderiv += (dadx_wfwf_r(p->get_traj(i),p->get_time(i),alpha1, alpha1p,alpha2,alpha2p,rho)+dadx_wfwf_r(p->get_traj(i-1),p->get_time(i-1),alpha1,alpha1p,alpha2,alpha2p,rho))/2.0
-			* (p->get_time(i)-p->get_time(i-1));
-			i++;
-		}
-        //and the last little bit, where I need a left limit
-		int_mderiv += (dadx_wfwf_r(p->get_traj(i),p->get_time(i),alpha1,alpha1p,alpha2,alpha2p,rho,1)+dadx_wfwf_r(p->get_traj(i-1),p->get_time(i-1),alpha1,alpha1p,alpha2,alpha2p,rho))/2.0
-		* (p->get_time(i)-p->get_time(i-1));
-		//then the "end" potential
-		Hm_wt += H_wfwf_r(p->get_traj(i), p->get_time(i), alpha1,alpha1p, alpha2,alpha2p, rho, 1);
-	}
-	
-	//compute the time integral of the square
-	double int_msquare = 0;
-	i = 1;
-	for (j = 0; j < dconts.size()-1; j++) {
-		//integrate over the interval using the trapezoid rule
-		while (p->get_time(i) < dconts[j+1]) {
-			int_msquare += (a2_wfwf_r(p->get_traj(i),p->get_time(i),alpha1,alpha1p,alpha2,alpha2p,rho)+a2_wfwf_r(p->get_traj(i-1),p->get_time(i-1),alpha1,alpha1p,alpha2,alpha2p,rho))/2.0
-			* (p->get_time(i)-p->get_time(i-1));
-			i++;
-		}
-        //and the last little bit, where I need a left limit
-        int_msquare += (a2_wfwf_r(p->get_traj(i),p->get_time(i),alpha1,alpha1p,alpha2,alpha2p,rho,1)+a2_wfwf_r(p->get_traj(i-1),p->get_time(i-1),alpha1,alpha1p,alpha2,alpha2p,rho))/2.0
-		* (p->get_time(i)-p->get_time(i-1));
+	cbp_wfwf_r_integrand f(alpha1, alpha1p, alpha2, alpha2p);
+	girsanov_sums s;
+	bool legal;
+	if (rho->is_constant()) {
+		constant_demography d(rho);
+		legal = integrate_girsanov(p, f, d, s);
+	} else {
+		variable_demography d(rho);
+		legal = integrate_girsanov(p, f, d, s);
 	}
-	
-	//compute the time integral of the time derivative
-	double int_mtime = 0;
-	i = 1;
-	for (j = 0; j < dconts.size()-1; j++) {
-		//integrate over the interval using the trapezoid rule
-		while (p->get_time(i) < dconts[j+1]) {
-			int_mtime += (dHdt_wfwf_r(p->get_traj(i),p->get_time(i),alpha1,alpha1p,alpha2,alpha2p,rho)+dHdt_wfwf_r(p->get_traj(i-1),p->get_time(i-1),alpha1,alpha1p,alpha2,alpha2p,rho))/2.0
-			* (p->get_time(i)-p->get_time(i-1));
-			i++;
-		}
-        //and the last little bit, where I need a left limit
-		int_mtime += (dHdt_wfwf_r(p->get_traj(i),p->get_time(i),alpha1,alpha1p,alpha2,alpha2p,rho,1)+dHdt_wfwf_r(p->get_traj(i-1),p->get_time(i-1),alpha1,alpha1p,alpha2,alpha2p,rho))/2.0
-		* (p->get_time(i)-p->get_time(i-1));
+	if (!legal) {
+		return -INFINITY; //Make sure the proposed path is stuck in the right space
 	}
 	
-    double gir = Hm_wt-Hm_w0-1.0/2.0*int_mderiv-1.0/2.0*int_msquare-int_mtime;
+    double gir = s.log_ratio();
     
     if (isnan(gir)) {
         std::cerr << "ERROR: log_girsanov_wfwf_r is NaN" << std::endl;
-        std::cerr << "Hm_wt = " << Hm_wt << " Hm_w0 = " << Hm_w0 << " int_mderiv = " << int_mderiv << " int_msquare = " << int_msquare << " int_mtime = " << int_mtime << std::endl;
+        std::cerr << "Hm_wt = " << s.H_end << " Hm_w0 = " << s.H_start << " int_mderiv = " << s.int_deriv << " int_msquare = " << s.int_square << " int_mtime = " << s.int_time << std::endl;
         exit(1);
     }
 	
@@ -388,27 +226,28 @@ double cbpMeasure::log_girsanov_wfwf_r(path* p, double alpha1, double alpha1p, d
 
 
 path* wienerMeasure::prop_path(double x0, double t0, double t, std::vector<double>& time_vec) {
-	std::vector<double> traj(time_vec.size(),0);
+	path* bm_path = new_path();
+	bm_path->set_grid(time_vec);
+	std::vector<double>::iterator traj = bm_path->get_traj_iterator(0);
 	traj[0] = x0;
 	for (int i = 1; i < time_vec.size(); i++) {
 		traj[i] = traj[i-1] + random->normalRv(0,sqrt(time_vec[i]-time_vec[i-1]));
 	}
 	
-	path* bm_path = new path(traj, time_vec);
-	
 	return bm_path;
 }
 
-path* wienerMeasure::make_bb_from_bm(path* bm,double u, double v) {
+path* wienerMeasure::make_bb_from_bm(path* bm,double u, double v, std::vector<double>& time_vec) {
 	double T = bm->get_time(bm->get_length()-1);
 	double t0 = bm->get_time(0);
 	double bT = bm->get_traj(bm->get_length()-1);
-	std::vector<double> p;
+	path* bb = new_path();
+	bb->set_grid(time_vec);
+	std::vector<double>::iterator p = bb->get_traj_iterator(0);
 	for (int i = 0; i < bm->get_length(); i++) {
 		double cur_val = (1-(bm->get_time(i)-t0)/(T-t0))*u + (bm->get_time(i)-t0)/(T-t0)*v+bm->get_traj(i)-(bm->get_time(i)-t0)/(T-t0)*bT;
-		p.push_back(cur_val);
+		p[i] = cur_val;
 	}
-	path* bb = new path(p, bm->get_time_ref());
 	return bb;
 }
 
@@ -416,8 +255,8 @@ path* wienerMeasure::prop_bridge(double x0, double xt, double t0, double t, std:
 	path* bm;
 	path* bb;
 	bm = prop_path(0,t0,t,time_vec);
-	bb = make_bb_from_bm(bm, x0, xt);
-	delete bm;
+	bb = make_bb_from_bm(bm, x0, xt, time_vec);
+	free_path(bm);
 	return bb;
 }
 
@@ -491,6 +330,7 @@ double cbpMeasure::rW(double kappa, int m) {
 
 path* cbpMeasure::prop_bridge(double x0, double xt, double t0, double t, std::vector<double>& time_vec) {
 	wienerMeasure myWiener(random);
+	myWiener.set_arena(arena);
 	int i;
 	std::vector<double> u(4,0);
 	u[3] = x0;
@@ -500,9 +340,11 @@ path* cbpMeasure::prop_bridge(double x0, double xt, double t0, double t, std::ve
 	for (i = 0; i < 4; i++) {
 		bb_paths[i] = myWiener.prop_bridge(u[i], xt*v[i], t0, t, time_vec);
 	}
-	std::vector<double> b4_traj;
+	path* bes4_bridge = new_path();
+	bes4_bridge->set_grid(time_vec);
+	std::vector<double>::iterator b4_traj = bes4_bridge->get_traj_iterator(0);
 	for (int j = 0; j < bb_paths[0]->get_length(); j++) {
-		b4_traj.push_back(0);
+		b4_traj[j] = 0;
 		for (i = 0; i < 4; i++) {
 			b4_traj[j] += pow(bb_paths[i]->get_traj(j),2);
 			if (isnan(b4_traj[j])) {
@@ -516,10 +358,9 @@ path* cbpMeasure::prop_bridge(double x0, double xt, double t0, double t, std::ve
 		}
 		b4_traj[j] = sqrt(b4_traj[j]);
 	}
-	path* bes4_bridge = new path(b4_traj,time_vec);
 	//clean up some memory
 	for (i = 0; i < bb_paths.size(); i++) {
-		delete bb_paths[i];
+		free_path(bb_paths[i]);
 	}
 	bb_paths.clear();
 	return bes4_bridge;
@@ -533,6 +374,20 @@ path* flippedCbpMeasure::prop_bridge(double x0, double xt, double t0, double t,
 	return myPath;
 }
 
+double wfMeasure::calibrate(double x0, double xt, double t0, double t, std::vector<double>& time_vec) {
+	cbpMeasure cbp(random);
+	double max_gir = -INFINITY;
+	for (int i = 0; i < num_test; i++) {
+		path* test_path = cbp.prop_bridge(x0,xt,t0,t,time_vec);
+		double gir = cbp.log_girsanov_wf(test_path, 0, 0);
+		if (gir > max_gir) {
+			max_gir = gir;
+		}
+		delete test_path;
+	}
+	return -(log(3) + max_gir);
+}
+
 path* wfMeasure::prop_bridge(double x0, double xt, double t0, double t, std::vector<double>& time_vec, double rescale) {
 	double dist_from_0 = x0;
 	if (xt < x0) dist_from_0 = xt;
@@ -546,25 +401,15 @@ path* wfMeasure::prop_bridge(double x0, double xt, double t0, double t, std::vec
 //		cbp = new flippedCbpMeasure(random);
 //	}
 	if (rescale == -INFINITY) {
-		double max_gir = -INFINITY;
-		for (int i = 0; i < num_test; i++) {
-			path* test_path = cbp->prop_bridge(x0,xt,t0,t,time_vec);
-			double gir = cbp->log_girsanov_wf(test_path, 0, 0);
-			if (gir > max_gir) {
-				max_gir = gir;
-			}
-			delete test_path;
-		}
-		rescale = -(log(3) + max_gir);
+		rescale = calibrate(x0, xt, t0, t, time_vec);
 	}
 	bool done = 0;
 	path* test_path;
 	double gir;
 	double accept_prob;
 	double u;
-    int num_tries = 0;
 	while (!done) {
-        num_tries++;
+        tries++;
 		test_path = cbp->prop_bridge(x0, xt, t0, t,time_vec);
 		gir = cbp->log_girsanov_wf(test_path, 0, 0);
 		accept_prob = rescale + gir;
@@ -579,6 +424,7 @@ path* wfMeasure::prop_bridge(double x0, double xt, double t0, double t, std::vec
 			delete test_path;
 		}
 	}
+	delete cbp;
 	return test_path;
 }
 
@@ -642,53 +488,35 @@ double cbpMeasure::dadx_wfwf(double x, double t, double alpha1, double alpha2) {
 }
 
 double cbpMeasure::H_wf_r(double x, double t, double alpha1, double alpha2, popsize* rho,bool leftLimit) {
-	if (x == 0) {
-		return -1.0/8.0*rho->getSize(t,leftLimit)*(2*alpha1+alpha2);
-	} else {
-		return log(x)/2.0-1.0/8.0*(rho->getSize(t,leftLimit)*cos(x)*(2*alpha2+(2*alpha1-alpha2)*cos(x))+4*log(sin(x)));
-	}
+	return cbp_wf_r_integrand(alpha1, alpha2).H(x, t, rho->getSize(t,leftLimit));
 }
 
 double cbpMeasure::dHdt_wf_r(double x, double t, double alpha1, double alpha2, popsize* rho, bool leftLimit) {
-	return -1.0/8.0*rho->getDeriv(t,leftLimit)*cos(x)*(2*alpha2+(2*alpha1-alpha2)*cos(x));
+	return cbp_wf_r_integrand(alpha1, alpha2).dHdt(x, t, rho->getDeriv(t,leftLimit));
 }
 
 double cbpMeasure::a2_wf_r(double x, double t, double alpha1, double alpha2, popsize* rho, bool leftLimit) {
-	if (x == 0) {
-		return -1.0/6.0*(1.0/rho->getSize(t,leftLimit)+3.0*alpha1);
-	} else {
-		return 1.0/(16.0*rho->getSize(t,leftLimit))*pow(rho->getSize(t,leftLimit)*sin(x)*(alpha2+(2*alpha1-alpha2)*cos(x))-2*1/tan(x),2)
-        - 1.0/(4.0*x*x*rho->getSize(t,leftLimit));
-	}
+	return cbp_wf_r_integrand(alpha1, alpha2).a2(x, t, rho->getSize(t,leftLimit));
 }
 
 double cbpMeasure::dadx_wf_r(double x, double t, double alpha1, double alpha2, popsize* rho, bool leftLimit) {
-	if (x == 0) {
-		return 1.0/6.0*(1.0/rho->getSize(t, leftLimit)+3.0*alpha1);
-	} else {
-		return 1.0/2.0*(alpha1*cos(x)+1.0/(sin(x)*sin(x)*rho->getSize(t,leftLimit)))-1.0/(2.0*x*x*rho->getSize(t,leftLimit));
-	}
+	return cbp_wf_r_integrand(alpha1, alpha2).dadx(x, t, rho->getSize(t,leftLimit));
 }
 
 double cbpMeasure::H_wfwf_r(double x, double t, double alpha1, double alpha1p, double alpha2, double alpha2p, popsize* rho, bool leftLimit) {
-	return 1.0/8.0*rho->getSize(t,leftLimit)*cos(x)*(2*(alpha2-alpha2p)+(2*(alpha1-alpha1p)+alpha2p-alpha2)*cos(x));
+	return cbp_wfwf_r_integrand(alpha1, alpha1p, alpha2, alpha2p).H(x, t, rho->getSize(t,leftLimit));
 }
 
 double cbpMeasure::dHdt_wfwf_r(double x, double t, double alpha1, double alpha1p, double alpha2, double alpha2p, popsize* rho, bool leftLimit) {
-	return 1.0/8.0*rho->getDeriv(t,leftLimit)*cos(x)*(2*(alpha2-alpha2p)+(2*(alpha1-alpha1p)+alpha2p-alpha2)*cos(x));
+	return cbp_wfwf_r_integrand(alpha1, alpha1p, alpha2, alpha2p).dHdt(x, t, rho->getDeriv(t,leftLimit));
 }
 
 double cbpMeasure::a2_wfwf_r(double x, double t, double alpha1, double alpha1p, double alpha2, double alpha2p, popsize* rho, bool leftLimit) {
-	return 1.0/64.0*(alpha2p-alpha2+(2*(alpha1p-alpha1)+alpha2-alpha2p)
-                     *cos(x))*((-16.0+2.0*rho->getSize(t,leftLimit)*(alpha1+alpha1p)
-                     -rho->getSize(t,leftLimit)*(alpha2+alpha2p))
-                     *cos(x) + (-2.0*(alpha1+alpha1p)+alpha2+alpha2p)
-                     *rho->getSize(t,leftLimit)*cos(3*x)+4*(alpha2+alpha2p)
-                     *rho->getSize(t,leftLimit)*sin(x)*sin(x));
-}
-																																																																	
+	return cbp_wfwf_r_integrand(alpha1, alpha1p, alpha2, alpha2p).a2(x, t, rho->getSize(t,leftLimit));
+}
+
 double cbpMeasure::dadx_wfwf_r(double x, double t, double alpha1, double alpha1p, double alpha2, double alpha2p, popsize* rho, bool leftLimit) {
-	return 1.0/2.0*(alpha1p-alpha1)*cos(x);
+	return cbp_wfwf_r_integrand(alpha1, alpha1p, alpha2, alpha2p).dadx(x, t, rho->getSize(t,leftLimit));
 }
 
 
@@ -20,12 +20,14 @@
 class path;
 class MbRandom;
 class popsize;
+class path_arena;
 
 class measure {
 	
 public:
 	//constructor
 	measure(MbRandom* r);
+	virtual ~measure() {}; //wfMeasure::prop_bridge deletes its cbpMeasure through a measure*
 	
 	//functions
 	virtual double a(double x,double t) = 0; //drift function
@@ -43,10 +45,16 @@ public:
 	virtual double log_girsanov_wf(path* p, double alpha, bool is_bridge = 0) {return NAN;};
 	virtual double log_girsanov_wf_r(path* p, double alpha, double h, popsize* rho, bool is_bridge = 0) {return NAN;};
 	
+	//if set, the paths made by prop_bridge come from the arena and must not be deleted
+	void set_arena(path_arena* a) {arena = a;};
+	
 protected:
 	path* sim_bm(double x0, double t0, double t, std::vector<double>& time_vec);
 	path* make_bb_from_bm(path* bm,double u, double v);
 	MbRandom* random; 
+	path_arena* arena;
+	path* new_path(); //from the arena if there is one, otherwise from the heap
+	void free_path(path* p); //deletes p unless it came from the arena
 	
 };
 
@@ -63,6 +71,8 @@ public:
 	//simulation
 	path* prop_bridge(double x0, double xt, double t0, double t, std::vector<double>& time_vec, double rescale);
 	path* prop_bridge(double x0, double xt, double t0, double t, std::vector<double>& time_vec) {return prop_bridge(x0, xt, t0, t,time_vec,-INFINITY);};
+	double calibrate(double x0, double xt, double t0, double t, std::vector<double>& time_vec); //the rescale prop_bridge works out from num_test test paths if it isn't given one
+	long get_tries() {return tries;}; //proposals made by prop_bridge so far, accepted or not
 	//transform variable
 	double fisher(double x) {return acos(1.0-2.0*x);};
 	double inverse_fisher(double x) {return (1.0-cos(x))/2.0;};
@@ -78,6 +88,7 @@ public:
 private:
 	double gamma; //selection coefficient
 	int num_test; 
+	long tries;
 };
 
 //Measure of 2\sqrt{X_t} where X_t is a critical continuous-state branching process
@@ -115,6 +126,7 @@ public:
 	double a2_wf_r(double x, double t, double alpha, double h, popsize* rho, bool leftLimit = 0);
 	double dadx_wf_r(double x, double t, double alpha, double h, popsize* rho, bool leftLimit = 0);
 	double log_girsanov_wf_r(path* p, double alpha, double h, popsize* rho, bool is_bridge);
+	double log_girsanov_wf_r_coarse_diff(path* p, double alpha1, double alpha2, popsize* rho); //|log_girsanov_wf_r(p, alpha1, alpha2, rho, 0) - the same for p on a grid twice as coarse|, a sign of the error from the grid rather than a bound
 	
 	//for Wright-Fisher with variable population size relative to Wright-Fisher with variable population size
 	//alpha1 is new alpha, alpha 2 is old alpha
@@ -171,7 +183,7 @@ public:
 	path* prop_path(double x0, double t0, double t, std::vector<double>& time_vec);
 
 private:
-	path* make_bb_from_bm(path* bm,double u, double v);
+	path* make_bb_from_bm(path* bm,double u, double v, std::vector<double>& time_vec);
 	
 };
 
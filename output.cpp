@@ -0,0 +1,240 @@
+/*
+ *  output.cpp
+ *  Selection_Recombination
+ *
+ */
+
+#include "output.h"
+#include "path.h"
+#include "settings.h"
+#include <iostream>
+#include <chrono>
+#include "math.h"
+
+//spin a little before going to sleep, so a busy ring doesn't pay for a wake up
+static void wait_a_bit(int& idle) {
+	idle++;
+	if (idle < 64) {
+		std::this_thread::yield();
+	} else {
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+	}
+}
+
+output_writer::output_writer(int slots) : ring(slots) {
+	head = 0;
+	tail = 0;
+	done = false;
+	wrote_grid = false;
+	last_grid_version = 0;
+	write_traj = true;
+	summary = NULL;
+	summary_burnin = 0;
+}
+
+output_writer::~output_writer() {
+	finish();
+}
+
+void output_writer::open(std::string baseName, int bufferSize, int level, int threads) {
+	std::string paramName = baseName + ".param.gz";
+	std::string trajName = baseName + ".traj.gz";
+	std::string timeName = baseName + ".time.gz";
+	paramFile.set_options(bufferSize, level, threads);
+	trajFile.set_options(bufferSize, level, threads);
+	timeFile.set_options(bufferSize, level, threads);
+	paramFile.open(paramName.c_str());
+	if (write_traj && !binFile.is_open()) {
+		trajFile.open(trajName.c_str());
+		timeFile.open(timeName.c_str());
+	}
+	if (!paramFile.good() || (write_traj && (!trajFile.good() || !timeFile.good()))) {
+		std::cerr << "ERROR: could not open output files with base name " << baseName << std::endl;
+		exit(1);
+	}
+}
+
+void output_writer::open_binary(std::string baseName, int bits, int bufferSize) {
+	std::string binName = baseName + ".traj.bin";
+	if (!binFile.open(binName, bits, bufferSize)) {
+		std::cerr << "ERROR: could not open " << binName << std::endl;
+		exit(1);
+	}
+}
+
+void output_writer::start(std::string paramHeader) {
+	paramFile << paramHeader << std::endl;
+	worker = std::thread(&output_writer::run, this);
+}
+
+state_record* output_writer::next_record() {
+	unsigned long h = head.load(std::memory_order_relaxed);
+	int idle = 0;
+	while (h - tail.load(std::memory_order_acquire) >= ring.size()) {
+		//ring is full, wait for the writer
+		wait_a_bit(idle);
+	}
+	return &ring[h % ring.size()];
+}
+
+void output_writer::publish() {
+	head.store(head.load(std::memory_order_relaxed)+1, std::memory_order_release);
+}
+
+void output_writer::finish() {
+	if (worker.joinable()) {
+		done.store(true, std::memory_order_release);
+		worker.join();
+	}
+	if (paramFile.rdbuf()->is_open()) {
+		paramFile.close();
+	}
+	if (trajFile.rdbuf()->is_open()) {
+		trajFile.close();
+		timeFile.close();
+	}
+	if (!binFile.close()) {
+		std::cerr << "ERROR: could not finish writing the binary trajectory file" << std::endl;
+	}
+}
+
+void output_writer::run() {
+	unsigned long next = 0;
+	int idle = 0;
+	while (true) {
+		if (next == head.load(std::memory_order_acquire)) {
+			//check done before looking at head again, so nothing published before finish() is missed
+			if (done.load(std::memory_order_acquire) && next == head.load(std::memory_order_acquire)) {
+				break;
+			}
+			wait_a_bit(idle);
+			continue;
+		}
+		idle = 0;
+		write(ring[next % ring.size()]);
+		next++;
+		tail.store(next, std::memory_order_release);
+	}
+}
+
+void output_writer::write(state_record& r) {
+	line.clear();
+	line.add(r.gen);
+	for (int i = 0; i < r.pars.size(); i++) {
+		line.add('\t');
+		line.add(r.pars[i]);
+	}
+	line.add('\n');
+	line.write_to(paramFile);
+	bool same_grid = wrote_grid && r.grid_version == last_grid_version;
+	wrote_grid = true;
+	last_grid_version = r.grid_version;
+	if (summary != NULL) {
+		if (!same_grid) {
+			summary_time = r.time;
+		}
+		if (r.gen >= summary_burnin) {
+			to_freq(r);
+			summary->add(freq, summary_time);
+		}
+	}
+	if (!write_traj) {
+		return;
+	}
+	if (binFile.is_open()) {
+		to_freq(r);
+		if (!binFile.write(r.gen, freq, r.time, same_grid)) {
+			std::cerr << "ERROR: could not write generation " << r.gen << " to the binary trajectory file" << std::endl;
+			exit(1);
+		}
+		return;
+	}
+	line.clear();
+	line.add(r.gen);
+	line.add(' ');
+	for (int i = 0; i < r.traj.size(); i++) {
+		line.add((1.0-cos(r.traj[i]))/2.0);
+		line.add(' ');
+	}
+	line.add('\n');
+	line.write_to(trajFile);
+	line.clear();
+	line.add(r.gen);
+	//a line with just the generation means the grid hasn't changed since the line before
+	if (same_grid) {
+		line.add('\n');
+		line.write_to(timeFile);
+		return;
+	}
+	line.add(' ');
+	for (int i = 0; i < r.time.size(); i++) {
+		line.add(r.time[i]);
+		line.add(' ');
+	}
+	line.add('\n');
+	line.write_to(timeFile);
+}
+
+void output_writer::to_freq(state_record& r) {
+	freq.resize(r.traj.size());
+	for (int i = 0; i < r.traj.size(); i++) {
+		freq[i] = (1.0-cos(r.traj[i]))/2.0;
+	}
+}
+
+file_sink::file_sink(settings& mySettings) {
+	lastGridVersion = (unsigned long)-1;
+	finished = false;
+	if (!mySettings.get_write_traj()) {
+		writer.skip_trajectories();
+	} else if (mySettings.get_binary_bits()) {
+		writer.open_binary(mySettings.get_baseName(), mySettings.get_binary_bits(), mySettings.get_gz_buffer());
+	}
+	summary = NULL;
+	if (mySettings.get_summary()) {
+		std::vector<double> grid = mySettings.parse_summary_pars();
+		summary = new path_summary(grid[0], grid[1], int(grid[2]));
+		summaryName = mySettings.get_baseName() + ".summary";
+		writer.set_summary(summary, int(grid[3]));
+	}
+	writer.open(mySettings.get_baseName(), mySettings.get_gz_buffer(), mySettings.get_gz_level(), mySettings.get_gz_threads());
+}
+
+file_sink::~file_sink() {
+	finish();
+	delete summary;
+}
+
+void file_sink::start(const std::vector<std::string>& columns) {
+	std::string header = "gen";
+	for (int i = 0; i < columns.size(); i++) {
+		header += "\t" + columns[i];
+	}
+	writer.start(header);
+}
+
+void file_sink::sample(int gen, const std::vector<double>& values, wfSamplePath* p) {
+	//just copy the numbers, the writer thread formats and compresses them
+	state_record* rec = writer.next_record();
+	rec->gen = gen;
+	rec->pars = values;
+	rec->traj.assign(p->get_traj_iterator(0), p->get_traj_iterator(p->get_length()));
+	rec->grid_version = p->get_grid_version();
+	if (rec->grid_version != lastGridVersion) {
+		//the writer doesn't look at the grid if it hasn't changed
+		rec->time.assign(p->get_time_iterator(0), p->get_time_iterator(p->get_length()));
+		lastGridVersion = rec->grid_version;
+	}
+	writer.publish();
+}
+
+void file_sink::finish() {
+	if (finished) {
+		return;
+	}
+	finished = true;
+	writer.finish();
+	if (summary != NULL) {
+		summary->write(summaryName);
+	}
+}
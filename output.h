@@ -0,0 +1,104 @@
+/*
+ *  output.h
+ *  Selection_Recombination
+ *
+ */
+
+#pragma once
+
+#ifndef output_H
+#define output_H
+
+#include "gzstream.h"
+#include "trajfile.h"
+#include "summary.h"
+#include "textbuf.h"
+#include <vector>
+#include <string>
+#include <atomic>
+#include <thread>
+
+class wfSamplePath;
+class settings;
+
+//one sample of the chain, as raw numbers. Formatting happens on the writer thread
+struct state_record {
+	int gen;
+	std::vector<double> pars; //everything on the line of the param file after gen
+	std::vector<double> traj; //the trajectory in transformed units, x = acos(1-2p)
+	std::vector<double> time;
+	unsigned long grid_version; //path::get_grid_version(), the time grid is only written when this changes
+};
+
+//Writes the .param.gz, .traj.gz and .time.gz files (or .traj.bin) on a background thread, and feeds
+//the trajectories to a path_summary if there is one. The chain fills records in a
+//single-producer/single-consumer ring and moves on; if the writer falls behind by the whole ring,
+//next_record() waits for it to catch up.
+class output_writer {
+public:
+	output_writer(int slots = 64);
+	~output_writer();
+
+	void open(std::string baseName, int bufferSize, int level, int threads); //opens the three files, see ogzstream::set_options
+	void open_binary(std::string baseName, int bits, int bufferSize); //use .traj.bin instead of .traj.gz and .time.gz
+	void skip_trajectories() {write_traj = false;}; //only the param file, call before open()
+	void set_summary(path_summary* s, int burnin) {summary = s; summary_burnin = burnin;}; //feed the samples from generation burnin on to s
+	void start(std::string paramHeader); //writes the header line of the param file and starts the thread
+	state_record* next_record(); //the record to fill in, only valid until publish()
+	void publish(); //hands the record from next_record() to the writer
+	void finish(); //writes everything that's left, stops the thread and closes the files
+
+private:
+	std::vector<state_record> ring;
+	std::atomic<unsigned long> head; //number of records published
+	std::atomic<unsigned long> tail; //number of records written
+	std::atomic<bool> done;
+	std::thread worker;
+
+	ogzstream paramFile;
+	ogzstream trajFile;
+	ogzstream timeFile;
+	traj_writer binFile;
+	bool write_traj;
+	path_summary* summary; //not owned, NULL for none
+	int summary_burnin;
+	std::vector<double> summary_time; //current time grid, kept for the summary since records only carry it when it changes
+	std::vector<double> freq; //the trajectory being written, as frequencies
+	text_buffer line; //the line being written, each line goes to its file in one write
+	bool wrote_grid; //has a time grid been written yet?
+	unsigned long last_grid_version; //version of the last time grid written
+
+	void run();
+	void write(state_record& r);
+	void to_freq(state_record& r); //fills freq from r.traj
+};
+
+//Gets the samples of a chain, see mcmc::add_sink
+class mcmc_sink {
+public:
+	virtual ~mcmc_sink() {};
+	virtual void start(const std::vector<std::string>& columns) {}; //names of the values sample() gets, before the first sample
+	virtual void sample(int gen, const std::vector<double>& values, wfSamplePath* p) = 0; //p is only valid during the call
+	virtual void finish() {}; //after the last sample
+};
+
+//the output files of sr, as asked for in the settings: the param file, the trajectories (through
+//an output_writer) and the summary
+class file_sink : public mcmc_sink {
+public:
+	file_sink(settings& mySettings);
+	~file_sink();
+
+	void start(const std::vector<std::string>& columns);
+	void sample(int gen, const std::vector<double>& values, wfSamplePath* p);
+	void finish();
+
+private:
+	output_writer writer;
+	path_summary* summary; //NULL for none
+	std::string summaryName;
+	unsigned long lastGridVersion; //time grid of the last sample handed to the writer
+	bool finished;
+};
+
+#endif
@@ -14,6 +14,7 @@
 #include "measure.h"
 #include "path.h"
 #include "popsize.h"
+#include "arena.h"
 
 #include <algorithm>
 #include <iomanip>
@@ -65,9 +66,13 @@ double param_gamma::propose() {
     return 0;
 }
 
+double param_gamma::log_prior(double x, double scaling) {
+	return -log(PI)+log(scaling)-log(x*x+scaling*scaling);
+}
+
 double param_gamma::prior() {
-	double pOld = -log(PI)+log(scaling)-log(oldVal*oldVal+scaling*scaling);
-	double pNew = -log(PI)+log(scaling)-log(curVal*curVal+scaling*scaling);
+	double pOld = log_prior(oldVal, scaling);
+	double pNew = log_prior(curVal, scaling);
 	return pNew-pOld;
 }
 
@@ -127,58 +132,33 @@ double sample_time::propose() {
     //curVal = reflectedUniform(oldVal, tuning, oldest, youngest);
     
     double startVal = curVal;
+    //indices are into the path's storage, so work relative to the start of the path
+    path* p = curParamPath->get_path();
+    int origin = p->get_origin();
+    int old_pos = (old_idx == -1) ? -1 : old_idx-origin;
     //Shift to closest value that's actually in the path
     //HOW BAD IS THIS IDEA???
-    if (curVal < curParamPath->get_path()->get_time(0)) {
+    if (curVal < p->get_time(0)) {
         //if it's older than the allele age, then set index = -1
         cur_idx = -1;
-    } else if (curVal < oldVal) {
-        //if less than, go down
-        for (int i = old_idx; i >= 0; i--) {
-            if (curParamPath->get_path()->get_time(i) < curVal) {
-                double up_time = curParamPath->get_path()->get_time(i+1);
-                double down_time = curParamPath->get_path()->get_time(i);
-                double up_dif = up_time-curVal;
-                double down_dif = curVal-down_time;
-                //std::cout << "curVal = " << curVal << std::endl;
-                //std::cout << "down_time = " << down_time << ", up_time = " << up_time << std::endl;
-                //std::cout << "down_dif = " << down_dif << ", up_dif = " << up_dif << std::endl;
-                if (down_dif < up_dif) {
-                    curVal = down_time;
-                    cur_idx = i;
-                } else {
-                    curVal = up_time;
-                    cur_idx = i+1;
-                }
-                break;
-            }
-        }
     } else {
-        //if greater than, go up
-        for (int i = old_idx; i < curParamPath->get_path()->get_length(); i++) {
-            if (i == -1) continue; //hack to deal with needing to start from the allele age
-            if (curParamPath->get_path()->get_time(i) > curVal) {
-                double up_time = curParamPath->get_path()->get_time(i);
-                double down_time = curParamPath->get_path()->get_time(i-1);
-                double up_dif = up_time-curVal;
-                double down_dif = curVal-down_time;
-                if (down_dif < up_dif) {
-                    curVal = down_time;
-                    cur_idx = i-1;
-                } else {
-                    curVal = up_time;
-                    cur_idx = i;
-                }
-                break;
-            }
+        //find the grid points on either side; ties go to the more recent one
+        std::vector<double>::iterator begin_it = p->get_time_iterator(0);
+        std::vector<double>::iterator end_it = p->get_time_iterator(p->get_length());
+        std::vector<double>::iterator up_it = std::lower_bound(begin_it, end_it, curVal);
+        if (up_it == end_it) {
+            up_it--;
         }
+        if (*up_it != curVal && up_it != begin_it && curVal-*(up_it-1) < *up_it-curVal) {
+            up_it--;
+        }
+        curVal = *up_it;
+        cur_idx = origin+(up_it-begin_it);
     }
-    //try to be clever
-//    if (cur_idx != -1 && sample_count > 0) {
-//        ((wfSamplePath*)curParamPath->get_path())->updateFirstNonzero(curVal, oldVal);
-//    }
-    //just brute force...
-    ((wfSamplePath*)curParamPath->get_path())->updateFirstNonzero();
+    if (sample_count > 0) {
+        ((wfSamplePath*)p)->updateFirstNonzero(curVal, oldVal);
+    }
+    ((wfSamplePath*)p)->markSample(sample_index);
     
     //OLD: truncated normal
     //double propRatio = random->truncatedNormalPdf(oldest, youngest, curVal, tuning, oldVal);
@@ -189,13 +169,13 @@ double sample_time::propose() {
     if (curVal > youngest || curVal < oldest) {
         std::cerr << "ERROR: sample_time proposal is outside of range" << std::endl;
         std::cerr << "oldest = " << oldest << ", youngest = " << youngest << std::endl;
-        std::cerr << "Allele age = " << curParamPath->get_path()->get_time(0) << std::endl;
+        std::cerr << "Allele age = " << p->get_time(0) << std::endl;
         std::cerr << "oldVal = " << oldVal << ", curVal = " << curVal << std::endl;
         std::cerr << "Starting curVal = " << startVal << std::endl;
         std::cerr << "Final curVal = " << curVal << std::endl;
         std::cerr << "old_idx = " << old_idx << ", cur_idx = " << cur_idx << std::endl;
-        std::cerr << "path->time(old_idx) = " << curParamPath->get_path()->get_time(old_idx) << std::endl;
-        std::cerr << "path->time(cur_idx) = " << curParamPath->get_path()->get_time(cur_idx) << std::endl;
+        std::cerr << "path->time(old_idx) = " << p->get_time(old_pos) << std::endl;
+        std::cerr << "path->time(cur_idx) = " << p->get_time(cur_idx-origin) << std::endl;
         std::cerr << "propRatio = " << propRatio << std::endl;
         //std::cin.ignore();
         exit(1);
@@ -269,7 +249,9 @@ double param_path::propose() {
 		end_index += minUpdate+curPath->get_length()/fracOfPath;
 		t = curPath->get_time(end_index);
 	}
-	double propRatio = propose(x0,xt,t0,t,curPath->get_time(start_index,end_index),start_index,end_index);
+	std::vector<double>* time_vec = arena->get_vector();
+	curPath->get_time(start_index,end_index,*time_vec);
+	double propRatio = propose(x0,xt,t0,t,*time_vec,start_index,end_index);
 	return propRatio;
 }
 
@@ -281,7 +263,9 @@ double param_path::proposeStart(double newStart) {
 	double xt = curPath->get_traj(end_index);
 	double t0 = curPath->get_time(start_index);
 	double t = curPath->get_time(end_index);
-	double propRatio = propose(x0,xt,t0,t,curPath->get_time(start_index,end_index),start_index,end_index);
+	std::vector<double>* time_vec = arena->get_vector();
+	curPath->get_time(start_index,end_index,*time_vec);
+	double propRatio = propose(x0,xt,t0,t,*time_vec,start_index,end_index);
 	return propRatio;
 }
 
@@ -292,10 +276,7 @@ double param_path::proposeAlleleAge(double newAge, double oldAge) {
     if (newAge < oldAge) {
         end_index = std::min(2*minUpdate, int(curPath->get_length()) - 1);
     } else {
-        end_index = 0;
-        while (curPath->get_time(end_index) < newAge) {
-            end_index++;
-        }
+        end_index = std::lower_bound(curPath->get_time_iterator(0), curPath->get_time_iterator(curPath->get_length()), newAge) - curPath->get_time_iterator(0);
         end_index = std::min(end_index + 2*minUpdate, int(curPath->get_length()) - 1);
 
         if (end_index > curPath->get_length()) {
@@ -315,15 +296,16 @@ double param_path::proposeAlleleAge(double newAge, double oldAge) {
 		t = curPath->get_time(end_index);
 	}
 	popsize* rho = ((wfSamplePath*)curPath)->get_pop();
-	std::vector<double> newTimeVector = make_time_vector(newAge, end_index, rho);
-	double propRatio = proposeAgePath(x0,xt,t0,t,newTimeVector, end_index);
+	std::vector<double>* newTimeVector = arena->get_vector();
+	make_time_vector(newAge, end_index, rho, *newTimeVector);
+	double propRatio = proposeAgePath(x0,xt,t0,t,*newTimeVector, end_index);
 	return propRatio;
 }
 
 //this makes a time vector that hits the sample times and their boundaries
-std::vector<double> param_path::make_time_vector(double newAge, int end_index, popsize* rho) {
+void param_path::make_time_vector(double newAge, int end_index, popsize* rho, std::vector<double>& newTimes) {
 	//figure out which times you need to include
-	std::vector<double> timesToInclude;
+	std::vector<double>& timesToInclude = *arena->get_vector();
 	timesToInclude.push_back(newAge);
     
     //go through times to get which ones are in between
@@ -367,25 +349,13 @@ std::vector<double> param_path::make_time_vector(double newAge, int end_index, p
     
     
     //create the vector, going between each pair of things
-	std::vector<double> newTimes;
+    //the new path starts from fOrigin at newAge and ends where the path is at end_index
+    grid_spacing spacing(min_dt, grid_adapt);
+    spacing.set_ends(newAge, fOrigin, endTime, curPath->get_traj(end_index));
+	newTimes.resize(0);
     newTimes.push_back(timesToInclude[0]);
 	for (int j = 0; j < timesToInclude.size()-1; j++) {
-		double dt = min_dt;
-		int steps = (timesToInclude[j+1]-timesToInclude[j])/dt+1;
-        if (steps < minUpdate) {
-            steps = minUpdate;
-        }
-        steps += 1;
-        dt = (timesToInclude[j+1]-timesToInclude[j])/(steps-1);
-        if (dt < 2*std::numeric_limits<double>::epsilon()) {
-            dt = 2*std::numeric_limits<double>::epsilon();
-            steps = (timesToInclude[j+1]-timesToInclude[j])/dt+1;
-        }
-        int end_k = newTimes.size()-1+steps;
-        for (int k = newTimes.size(); k < end_k; k++) {
-            newTimes.push_back(newTimes[k-1]+dt);
-        }
-        newTimes[newTimes.size()-1] = timesToInclude[j+1];
+        path::extend_grid(newTimes, timesToInclude[j+1], spacing, minUpdate);
         if (!(newTimes[newTimes.size()-1] > newTimes[newTimes.size()-2])) {
             newTimes.resize(newTimes.size()-1);
         }
@@ -413,8 +383,6 @@ std::vector<double> param_path::make_time_vector(double newAge, int end_index, p
 //            exit(1);
 //        }
 //    }
-
-	return newTimes;
 }
 
 //updates from the end
@@ -425,20 +393,24 @@ double param_path::proposeEnd(double newEnd) {
 	double xt = newEnd;
 	double t0 = curPath->get_time(start_index);
 	double t = curPath->get_time(end_index);
-	double propRatio = propose(x0,xt,t0,t,curPath->get_time(start_index,end_index),start_index,end_index);
+	std::vector<double>* time_vec = arena->get_vector();
+	curPath->get_time(start_index,end_index,*time_vec);
+	double propRatio = propose(x0,xt,t0,t,*time_vec,start_index,end_index);
 	return propRatio;
 }
 
 //does most of the hard work
-double param_path::propose(double x0, double xt, double t0, double t, std::vector<double> time_vec, int start_index, int end_index) {
+double param_path::propose(double x0, double xt, double t0, double t, std::vector<double>& time_vec, int start_index, int end_index) {
 	//convert the times to tau times
 	popsize* rho = ((wfSamplePath*)curPath)->get_pop();
-	std::vector<double> tau_vec = rho->getTau(time_vec);
+	std::vector<double>& tau_vec = *arena->get_vector();
+	rho->getTau(time_vec, tau_vec);
 	double tau0 = rho->getTau(t0);
 	double tau = rho->getTau(t);
 	
 	
 	cbpMeasure myCBP(random);
+	myCBP.set_arena(arena);
 	double dist_from_0 = x0;
 	if (xt < x0) dist_from_0 = xt;
 	double dist_from_pi = PI-xt;
@@ -449,7 +421,8 @@ double param_path::propose(double x0, double xt, double t0, double t, std::vecto
 //		myCBP = new flippedCbpMeasure(random);
 //	}
 	newPath = myCBP.prop_bridge(x0, xt, tau0, tau,tau_vec);
-	oldPath = curPath->extract_path(start_index, end_index+1);
+	oldPath = arena->get_path();
+	curPath->extract_path(start_index, end_index+1, oldPath);
 	
 	newPath->replace_time(time_vec);
 	curPath->modify(newPath,start_index);
@@ -460,26 +433,25 @@ double param_path::propose(double x0, double xt, double t0, double t, std::vecto
 	propRatio += myCBP.log_girsanov_wf_r(newPath, a1->get(), a2->get(),rho, 1);
 	propRatio -= myCBP.log_girsanov_wf_r(oldPath, a1->get(), a2->get(),rho, 1);
 	
-	
-	delete newPath;
-	delete oldPath;
-	
 	return propRatio;
 }
 
-double param_path::proposeAgePath(double x0,double xt,double t0,double t, std::vector<double> time_vec, int end_index) {
+double param_path::proposeAgePath(double x0,double xt,double t0,double t, std::vector<double>& time_vec, int end_index) {
 	//convert the times to tau times
 	popsize* rho = ((wfSamplePath*)curPath)->get_pop();
-	std::vector<double> tau_vec = rho->getTau(time_vec);
+	std::vector<double>& tau_vec = *arena->get_vector();
+	rho->getTau(time_vec, tau_vec);
 	double tau0 = rho->getTau(t0);
 	double tau = rho->getTau(t);
 	
 	cbpMeasure myCBP(random);
+	myCBP.set_arena(arena);
 	newPath = myCBP.prop_bridge(x0, xt, tau0, tau, tau_vec);
 	
 	//these things, for computing the probability of the Bessel guy making it
 	//should be in units of tau, so need to transform oldPath
-	oldPath = curPath->extract_path(0,end_index+1);
+	oldPath = arena->get_path();
+	curPath->extract_path(0,end_index+1,oldPath);
 	double tOld = rho->getTau(oldPath->get_time(oldPath->get_length()-1))-rho->getTau(oldPath->get_time(1));
 	double tNew = newPath->get_time(newPath->get_length()-1)-newPath->get_time(1);
     
@@ -535,12 +507,6 @@ double param_path::proposeAgePath(double x0,double xt,double t0,double t, std::v
 		std::cerr << -1.0/2.0*xt*xt*(1.0/tNew-1.0/tOld)+2*log(tOld)-2*log(tNew) << std::endl;
 		exit(1);
 	}
-    
-   
-	
-	delete newPath;
-	delete oldPath;
-    
 	
 	return propRatio;
 }
@@ -552,7 +518,9 @@ void param_path::reset() {
 void sample_time::reset() {
     curVal = oldVal;
     cur_idx = old_idx;
-    ((wfSamplePath*)curParamPath->get_path())->resetFirstNonzero();
+    if (sample_count > 0) {
+        ((wfSamplePath*)curParamPath->get_path())->resetFirstNonzero();
+    }
 }
 
 void param_age::reset() {
@@ -19,13 +19,14 @@ class path;
 class settings;
 class popsize;
 class wfSamplePath;
+class path_arena;
 
 class param {
 	
 public:
     param(MbRandom* r) {curVal = 0; oldVal = 0; tuning = 1; random = r; numProp = 0; numTunings = 0; numAccept = 0; minTuning = 0;};
     param(double x, MbRandom* r) {curVal = x; random = r; oldVal = x; tuning = 1; numTunings = 0; numProp = 0; numAccept = 0; minTuning = 0; maxTuning = 0;}
-    ~param() {};
+    virtual ~param() {};
 	virtual double propose() = 0; //return proposal ratio!
 	virtual double prior() = 0; //return prior ratio!
 	virtual void updateTuning();
@@ -35,6 +36,8 @@ public:
 	double get() {return curVal;};
 	double getOld() {return oldVal;};
 	double getTuning() {return tuning;};
+	int getNumProp() {return numProp;};
+	int getNumAccept() {return numAccept;};
 	void setOld(double v) {oldVal = v;};
     void setNew(double v) {oldVal = curVal; curVal = v;};
 	
@@ -58,9 +61,10 @@ protected:
 
 class param_gamma: public param {
 public:
-    param_gamma(double x, MbRandom* r): param(x, r) {scaling = 10.0; tuning=10.0; minTuning=0.0;};
+    param_gamma(double x, MbRandom* r, double s = 10.0): param(x, r) {scaling = s; tuning=10.0; minTuning=0.0;};
 	double propose(); 
 	double prior(); 
+	static double log_prior(double x, double scaling); //Cauchy, for prior() and reweighting
 	
 private:
 	double scaling;
@@ -87,14 +91,15 @@ public:
 class param_path: public param {
 public:
 	//param_path(path* p, param_gamma* al1, param_gamma* al2, MbRandom* r): param(r) {curPath = p; minUpdate = 10; fracOfPath = 10; min_dt = .001; grid = 10; a1 = al1; a2 = al2;};
-	param_path(path* p, param_gamma* al1, param_gamma* al2, MbRandom* r, settings& s): param(r) {curPath = p; minUpdate = s.getMinUpdate(); fracOfPath = s.getFracOfPath(); min_dt = s.get_dt(); grid = s.get_grid(); fOrigin = acos(1.0-2.0*s.get_fOrigin()); a1 = al1; a2 = al2;};
-    ~param_path() {delete curPath; delete newPath; delete oldPath;};
+	//the temporary paths for each proposal come from scratch, which the caller resets between proposals
+	param_path(path* p, param_gamma* al1, param_gamma* al2, MbRandom* r, settings& s, path_arena* scratch): param(r) {curPath = p; minUpdate = s.getMinUpdate(); fracOfPath = s.getFracOfPath(); min_dt = s.get_dt(); grid = s.get_grid(); grid_adapt = s.get_grid_adapt(); fOrigin = acos(1.0-2.0*s.get_fOrigin()); a1 = al1; a2 = al2; arena = scratch;};
+    ~param_path() {delete curPath;};
 	double propose();
 	double proposeAlleleAge(double newAge, double oldAge);
 	double proposeStart(double newStart);
 	double proposeEnd(double newEnd);
-	double propose(double x0, double xt, double t0, double t, std::vector<double> time_vec, int start_index, int end_index);
-	double proposeAgePath(double x0,double xt,double t0,double t, std::vector<double> time_vec, int end_index);
+	double propose(double x0, double xt, double t0, double t, std::vector<double>& time_vec, int start_index, int end_index);
+	double proposeAgePath(double x0,double xt,double t0,double t, std::vector<double>& time_vec, int end_index);
 	double prior() {return 0;};
 	void updateTuning() {};
 	void reset();
@@ -105,14 +110,16 @@ private:
 	int fracOfPath;
 	double min_dt;
 	double grid;
+	double grid_adapt; //-x, 0 for evenly spaced grids
 	double fOrigin;
 	path* curPath;
 	path* newPath;
 	path* oldPath;
 	param_gamma* a1;
 	param_gamma* a2;
+	path_arena* arena;
 	
-	std::vector<double> make_time_vector(double newAge, int end_index, popsize* rho);
+	void make_time_vector(double newAge, int end_index, popsize* rho, std::vector<double>& newTimes);
 };
 
 //NB: even though it says "freq", this really the transformed frequency
@@ -152,10 +159,13 @@ public:
         tuning = (youngest-oldest)/2.0;
         cur_idx = -1;
         old_idx = -1;
+        sample_index = -1;
+        lchoose = lgamma(ss+1)-lgamma(sc+1)-lgamma(ss-sc+1);
     };
     
     double get_ss() {return sample_size;};
     double get_sc() {return sample_count;};
+    double get_lchoose() {return lchoose;}; //log(sample_size choose sample_count), fixed at parse time
     
     double get_oldest() {return oldest;};
     double get_youngest() {return youngest;};
@@ -163,11 +173,14 @@ public:
     int get_oldest_idx() {return oldest_idx;};
     int get_youngest_idx() {return youngest_idx;};
     int get_idx() {return cur_idx;};
+    int get_sample_index() {return sample_index;};
+    void set_sample_index(int i) {sample_index = i;}; //position in the path's list of samples
     
     void set_oldest_idx(int i) {oldest_idx = i;};
     void set_youngest_idx(int i) {youngest_idx = i;};
     void set_idx(int i) {old_idx = cur_idx; cur_idx = i;}; //keeps time the same, but changes the idx
     void reset_idx() {cur_idx = old_idx;};
+    void shift_idx(int d) {if (cur_idx != -1) cur_idx += d; if (old_idx != -1) old_idx += d;}; //the path storage moved
     void reset();
     
     
@@ -184,6 +197,7 @@ private:
     double youngest;
     
     //index of most ancient time, most recent time, current value
+    //NB: cur_idx and old_idx index the path's storage, i.e. they are offset by path::get_origin()
     int oldest_idx;
     int youngest_idx;
     int cur_idx;
@@ -192,6 +206,8 @@ private:
     //sample relevant information
     int sample_count;
     int sample_size;
+    double lchoose;
+    int sample_index;
     param_path* curParamPath;
 };
 
@@ -14,6 +14,7 @@
 #include "measure.h"
 #include "popsize.h"
 #include "param.h"
+#include "textbuf.h"
 
 #include <vector>
 #include <string>
@@ -36,7 +37,15 @@ struct compare_index
 
 //builds a bridge from x0 to xt 
 path::path(double x0, double xt, double t0, double t, measure* m, settings& s) {
-	//create the time vector
+	time_grid(t0, t, s, time);
+	origin = 0;
+	grid_version = old_grid_version = grid_counter = 0;
+	path* temp = m->prop_bridge(x0, xt, t0, t,time);
+	trajectory = temp->get_traj();
+	delete temp;
+}
+
+void path::time_grid(double t0, double t, settings& s, std::vector<double>& time) {
 	double dt = s.get_dt();
 	int min_steps = s.get_grid();
 	int steps = (t-t0)/dt+1;
@@ -51,14 +60,83 @@ path::path(double x0, double xt, double t0, double t, measure* m, settings& s) {
 		time[i] = time[i-1] + dt;
 	}
 	time[steps-1] = t; //HACK TO MAKE SURE THAT MACHINE ERROR DOESN'T FUCK ME UP
-	path* temp = m->prop_bridge(x0, xt, t0, t,time);
-	trajectory = temp->get_traj();
-	delete temp;
+}
+
+//with -x, the grid gets at most this much finer than -d
+static const double max_refinement = 64;
+
+grid_spacing::grid_spacing(double m, double a) {
+	max_dt = m;
+	adaptive = a;
+	ta = tb = 0;
+	sa = sb = INFINITY;
+}
+
+void grid_spacing::set_ends(double t0, double x0, double t, double xt) {
+	//only the distance from pi counts: near 0, the drift of the Bessel process the likelihood is
+	//relative to cancels the fast changing part of the drift
+	ta = t0;
+	sa = (PI-x0)*(PI-x0);
+	tb = t;
+	sb = (PI-xt)*(PI-xt);
+}
+
+double grid_spacing::at(double t) {
+	if (adaptive <= 0) {
+		return max_dt;
+	}
+	double h = std::min(max_dt, adaptive*(sa+fabs(t-ta)));
+	h = std::min(h, adaptive*(sb+fabs(tb-t)));
+	return std::max(h, max_dt/max_refinement);
+}
+
+int path::extend_grid(std::vector<double>& time, double t, grid_spacing& h, int min_steps) {
+	double t0 = time[time.size()-1];
+	int first = time.size();
+	if (h.is_adaptive()) {
+		//step by the local spacing, and split what's left in two at the end rather than leave a sliver
+		double cur = t0;
+		double step = std::max(h.at(cur), 2*std::numeric_limits<double>::epsilon());
+		while (t-cur > step) {
+			if (t-cur < 2*step) {
+				cur += (t-cur)/2;
+				time.push_back(cur);
+				break;
+			}
+			cur += step;
+			time.push_back(cur);
+			step = std::max(h.at(cur), 2*std::numeric_limits<double>::epsilon());
+		}
+		time.push_back(t);
+		if (time.size()-first >= min_steps) {
+			return time.size()-first;
+		}
+		//too few points, so fall back on the uniform grid with min_steps steps
+		time.resize(first);
+	}
+	int steps = (t-t0)/h.get_max_dt()+1;
+	if (steps < min_steps) {
+		steps = min_steps;
+	}
+	steps += 1;
+	double dt = (t-t0)/(steps-1);
+	if (dt < 2*std::numeric_limits<double>::epsilon()) {
+		dt = 2*std::numeric_limits<double>::epsilon();
+		steps = (t-t0)/dt+1;
+	}
+	int end_k = time.size()-1+steps;
+	for (int k = time.size(); k < end_k; k++) {
+		time.push_back(time[k-1]+dt);
+	}
+	time[time.size()-1] = t;
+	return steps-1;
 }
 
 //builds a bridge from x0 to xt with a fixed time vector
 path::path(double x0, double xt, double t0, double t, measure* m, std::vector<double>& tvec) {
 	time = tvec;
+	origin = 0;
+	grid_version = old_grid_version = grid_counter = 0;
 	path* temp = m->prop_bridge(x0, xt, t0, t,time);
 	trajectory = temp->get_traj();
 	delete temp;
@@ -67,12 +145,12 @@ path::path(double x0, double xt, double t0, double t, measure* m, std::vector<do
 void path::print(std::ostream& o) {
 	int i;
 	o << "trajectory ";
-	for (i = 0; i < trajectory.size(); i++) {
+	for (i = origin; i < trajectory.size(); i++) {
 		o << trajectory[i] << " ";
 	}
 	o << std::endl;
 	o << "time ";
-	for (i = 0; i < trajectory.size(); i++) {
+	for (i = origin; i < trajectory.size(); i++) {
 		o << time[i] << " ";
 	}
 	o << std::endl;
@@ -81,45 +159,53 @@ void path::print(std::ostream& o) {
 void path::print_tsv(std::ostream& o) {
 	int i;
 	o << "trajectory\ttime" << std::endl ;
-	for (i = 0; i < trajectory.size(); i++) {
+	for (i = origin; i < trajectory.size(); i++) {
 		o << trajectory[i] << "\t" << time[i] << std::endl;
 	}
 }
 
 void path::print_traj(std::ostream& o) {
-	int i;
-	for (i = 0; i < trajectory.size(); i++) {
-		o << trajectory[i] << " ";
+	text_buffer line;
+	for (int i = origin; i < trajectory.size(); i++) {
+		line.add(trajectory[i], o.precision());
+		line.add(' ');
 	}
+	line.write_to(o);
 	o << std::endl;
 }
 
 void path::print_traj(ogzstream& o) {
-    int i;
-    for (i = 0; i < trajectory.size(); i++) {
-        o << trajectory[i] << " ";
+    text_buffer line;
+    for (int i = origin; i < trajectory.size(); i++) {
+        line.add(trajectory[i], o.precision());
+        line.add(' ');
     }
+    line.write_to(o);
     o << std::endl;
 }
 
 void path::print_time(std::ostream& o) {
-	int i;
-	for (i = 0; i < time.size(); i++) {
-		o << time[i] << " ";
+	text_buffer line;
+	for (int i = origin; i < time.size(); i++) {
+		line.add(time[i], o.precision());
+		line.add(' ');
 	}
+	line.write_to(o);
 	o << std::endl;
 }
 
 void path::print_time(ogzstream& o) {
-    int i;
-    for (i = 0; i < time.size(); i++) {
-        o << time[i] << " ";
+    text_buffer line;
+    for (int i = origin; i < time.size(); i++) {
+        line.add(time[i], o.precision());
+        line.add(' ');
     }
+    line.write_to(o);
     o << std::endl;
 }
 
 void path::flipCbp() {
-	for (int i = 0; i < trajectory.size(); i++) {
+	for (int i = origin; i < trajectory.size(); i++) {
 		trajectory[i] = PI-trajectory[i];
 	}
 }
@@ -129,6 +215,7 @@ void path::append(path* p) {
 		trajectory.push_back(p->get_traj(i));
 		time.push_back(p->get_time(i));
 	}
+	new_grid_version();
 }
 
 void path::append(path* p, int i) {
@@ -136,31 +223,39 @@ void path::append(path* p, int i) {
 		trajectory.push_back(p->get_traj(j));
 		time.push_back(p->get_time(j));
 	}
+	new_grid_version();
 }
 
 void path::insert(path* p, int i) {
-	trajectory.insert(trajectory.begin()+i,p->get_traj_iterator(0),p->get_traj_iterator(p->get_length()));
-	time.insert(time.begin()+i,p->get_time_iterator(0),p->get_time_iterator(p->get_length()));
+	trajectory.insert(trajectory.begin()+origin+i,p->get_traj_iterator(0),p->get_traj_iterator(p->get_length()));
+	time.insert(time.begin()+origin+i,p->get_time_iterator(0),p->get_time_iterator(p->get_length()));
+	new_grid_version();
 }
 
 void path::modify(path* p, int i) {
+	old_grid_version = grid_version;
 	if (i != -1 || p != NULL) {
 		old_index = i;
 		int old_length = p->get_length();
+		bool grid_moved = false;
 		old_trajectory.resize(0);
 		old_time.resize(0);
         //old_trajectory.resize(old_length);
         //old_time.resize(old_length);
+		int k = origin+i;
 		for (int j = 0; j < old_length; j++) {
-			old_trajectory.push_back(trajectory[i+j]);
-            //old_trajectory[j] = trajectory[i+j];
-			trajectory[i+j] = p->get_traj(j);
-			old_time.push_back(time[i+j]);
-            //old_time[j] = time[i+j];
-			time[i+j] = p->get_time(j);
-            if (i+j > 0 && time.at(i+j) < time.at(i+j-1)) {
+			old_trajectory.push_back(trajectory[k+j]);
+            //old_trajectory[j] = trajectory[k+j];
+			trajectory[k+j] = p->get_traj(j);
+			old_time.push_back(time[k+j]);
+            //old_time[j] = time[k+j];
+			if (time[k+j] != p->get_time(j)) {
+				grid_moved = true;
+			}
+			time[k+j] = p->get_time(j);
+            if (i+j > 0 && time.at(k+j) < time.at(k+j-1)) {
                 std::cerr << "ERROR: time vector is not sorted!" << std::endl;
-                std::cerr << time[i+j] << " < " << time[i+j-1] << std::endl;
+                std::cerr << time[k+j] << " < " << time[k+j-1] << std::endl;
                 exit(1);
             }
 		}
@@ -170,6 +265,9 @@ void path::modify(path* p, int i) {
             std::cerr << "time.size() = " << time.size() << std::endl;
             exit(1);
         }
+		if (grid_moved) {
+			new_grid_version();
+		}
 	} else {
 		old_trajectory.resize(0);
 		old_time.resize(0);
@@ -179,10 +277,12 @@ void path::modify(path* p, int i) {
 
 void path::reset() {
 	if (old_index != -1) {
+		int k = origin+old_index;
 		for (int j = 0; j < old_trajectory.size(); j++) {
-			trajectory[old_index+j] = old_trajectory[j];
-			time[old_index+j] = old_time[j];
+			trajectory[k+j] = old_trajectory[j];
+			time[k+j] = old_time[j];
 		}
+		grid_version = old_grid_version;
 	}
     if (trajectory.size() != time.size()) {
         std::cerr << "ERROR: Path trajectory and time are not same length!" << std::endl;
@@ -194,15 +294,19 @@ void path::reset() {
 
 std::vector<double> path::get_time(int i, int j) {
 	std::vector<double> timeSlice(0,0);
-	for (int k = i; k < j+1; k++) {
+	for (int k = origin+i; k < origin+j+1; k++) {
 		timeSlice.push_back(time[k]);
 	}
 	return timeSlice;
 }
 
+void path::get_time(int i, int j, std::vector<double>& timeSlice) {
+	timeSlice.assign(time.begin()+origin+i, time.begin()+origin+j+1);
+}
+
 std::vector<double> path::get_traj(int i, int j) {
 	std::vector<double> trajSlice(0,0);
-	for (int k = i; k < j+1; k++) {
+	for (int k = origin+i; k < origin+j+1; k++) {
 		trajSlice.push_back(trajectory[k]);
 	}
 	return trajSlice;
@@ -211,7 +315,7 @@ std::vector<double> path::get_traj(int i, int j) {
 path* path::extract_path(int i, int j) {
 	std::vector<double> new_time(0);
 	std::vector<double> new_traj(0);
-	for (int k = i; k < j; k++) {
+	for (int k = origin+i; k < origin+j; k++) {
 		new_time.push_back(time[k]);
 		new_traj.push_back(trajectory[k]);
 	}
@@ -219,6 +323,12 @@ path* path::extract_path(int i, int j) {
 	return new_path;
 }
 
+void path::extract_path(int i, int j, path* p) {
+	p->trajectory.assign(trajectory.begin()+origin+i, trajectory.begin()+origin+j);
+	p->time.assign(time.begin()+origin+i, time.begin()+origin+j);
+	p->origin = 0;
+}
+
 std::vector<double> wfSamplePath::parse_comma_sep(char* c) {
 	std::vector<double> pars(0);
 	std::string string_pars(c);
@@ -241,6 +351,10 @@ std::vector<double> wfSamplePath::sortByIndex(std::vector<double>& vec, std::vec
 }
 
 double wfSamplePath::sampleProb(int k, int n, double y) {
+    return sampleProb(k, n, y, lgamma(n+1)-lgamma(k+1)-lgamma(n-k+1));
+}
+
+double wfSamplePath::sampleProb(int k, int n, double y, double lchoose) {
     double sp = 0;
     //get the actual frequency
     double p = (1.0-cos(y))/2.0;
@@ -254,27 +368,52 @@ double wfSamplePath::sampleProb(int k, int n, double y) {
         }
     } else if (F->get() == 0) {
         //binomial
-        sp += lgamma(n+1)-lgamma(k+1)-lgamma(n-k+1);
+        sp += lchoose;
         sp += k*log(p);
         sp += (n-k)*log(1-p);
     } else {
         //beta binomial
         double a = (1-F->get())/F->get()*p;
         double b =(1-F->get())/F->get()*(1-p);
-        sp += lgamma(n+1)-lgamma(k+1)-lgamma(n-k+1);
-        sp += lgamma(k+a) + lgamma(n-k+b) - lgamma(n+a+b);
-        sp += lgamma(a+b) - lgamma(a) - lgamma(b);
+        sp += lchoose;
+        sp += logBetaBinomialRatio(k, n, a, b);
     }
     return sp;
 }
 
+//log of (a)_k (b)_{n-k} / (a+b)_n, i.e. the beta-binomial probability without the binomial coefficient
+double wfSamplePath::logBetaBinomialRatio(int k, int n, double a, double b) {
+    if (n > 64) {
+        return lgamma(k+a) + lgamma(n-k+b) - lgamma(n+a+b) + lgamma(a+b) - lgamma(a) - lgamma(b);
+    }
+    //for small n, multiply out the rising factorials
+    //(a+b)_n = (a+b)_k (a+b+k)_{n-k}, so pair them up and every factor is <= 1
+    double lr = 0;
+    double prod = 1;
+    for (int j = 0; j < k; j++) {
+        prod *= (a+j)/(a+b+j);
+        if (prod < 1e-200) {
+            lr += log(prod);
+            prod = 1;
+        }
+    }
+    for (int j = 0; j < n-k; j++) {
+        prod *= (b+j)/(a+b+k+j);
+        if (prod < 1e-200) {
+            lr += log(prod);
+            prod = 1;
+        }
+    }
+    return lr + log(prod);
+}
+
 double wfSamplePath::sampleProb(int i) {
 	int idx = sample_time_vec[i]->get_idx();
     double sc = sample_time_vec[i]->get_sc();
     double ss = sample_time_vec[i]->get_ss();
 	double sp = 0;
 	if (idx != -1) {
-        sp += sampleProb(sc,ss,trajectory.at(idx));
+        sp += sampleProb(sc,ss,trajectory.at(idx),sample_time_vec[i]->get_lchoose());
 	} else {
 		if (sc == 0) {
 			sp += 0;
@@ -285,28 +424,136 @@ double wfSamplePath::sampleProb(int i) {
 	return sp;
 }
 
-double wfSamplePath::ascertainModern(int min) {
-    int idx = sample_time_vec[sample_time_vec.size()-1]->get_idx();
-    double ss = sample_time_vec[sample_time_vec.size()-1]->get_ss();
-    double pA = 0;
-    for (int k = min; k < ss; k++) {
-        pA += exp(sampleProb(k, ss, trajectory.at(idx)));
+//Lentz's continued fraction for the incomplete beta function, see Numerical Recipes 6.4
+static double betacf(double a, double b, double x) {
+    const double eps = 1e-15;
+    const double fpmin = 1e-300;
+    double qab = a+b;
+    double qap = a+1.0;
+    double qam = a-1.0;
+    double c = 1.0;
+    double d = 1.0-qab*x/qap;
+    if (fabs(d) < fpmin) d = fpmin;
+    d = 1.0/d;
+    double h = d;
+    for (int m = 1; m <= 10000; m++) {
+        int m2 = 2*m;
+        double aa = m*(b-m)*x/((qam+m2)*(a+m2));
+        d = 1.0+aa*d;
+        if (fabs(d) < fpmin) d = fpmin;
+        c = 1.0+aa/c;
+        if (fabs(c) < fpmin) c = fpmin;
+        d = 1.0/d;
+        h *= d*c;
+        aa = -(a+m)*(qab+m)*x/((a+m2)*(qap+m2));
+        d = 1.0+aa*d;
+        if (fabs(d) < fpmin) d = fpmin;
+        c = 1.0+aa/c;
+        if (fabs(c) < fpmin) c = fpmin;
+        d = 1.0/d;
+        double del = d*c;
+        h *= del;
+        if (fabs(del-1.0) < eps) break;
     }
-    return log(pA);
+    return h;
 }
 
-double wfSamplePath::ascertainAncient() {
-    double pNone = 0;
-    for (int i = 0; i < sample_time_vec.size()-1; i++) {
-        int idx = sample_time_vec[i]->get_idx();
-        double ss = sample_time_vec[i]->get_ss();
-        if (idx > 0) {
-            //P(current time has 0 derived alleles)
-            pNone += sampleProb(0,ss,trajectory.at(idx));
+//log of the regularized incomplete beta function I_x(a,b), lbeta = log(B(a,b))
+static double log_incomplete_beta(double a, double b, double x, double lbeta) {
+    double front = a*log(x) + b*log1p(-x) - lbeta;
+    if (x < (a+1.0)/(a+b+2.0)) {
+        return front + log(betacf(a,b,x)/a);
+    } else {
+        return log1p(-exp(front + log(betacf(b,a,1.0-x)/b)));
+    }
+}
+
+//log sum_{k=m}^{n-1} P(k of n), starting from P(m of n) and stepping with the ratio of successive terms
+double wfSamplePath::logTailSum(int m, int n, double y) {
+    if (m >= n) {
+        return -INFINITY;
+    }
+    double p = (1.0-cos(y))/2.0;
+    double lp0 = sampleProb(m, n, y);
+    double a = 0;
+    double b = 0;
+    if (F->get() != 0) {
+        a = (1-F->get())/F->get()*p;
+        b = (1-F->get())/F->get()*(1-p);
+    }
+    double odds = p/(1-p);
+    //s*exp(ls) is the sum relative to P(m of n)
+    double term = 1;
+    double s = 1;
+    double ls = 0;
+    for (int k = m; k < n-1; k++) {
+        double ratio = double(n-k)/(k+1);
+        if (F->get() == 0) {
+            ratio *= odds;
+        } else {
+            ratio *= (k+a)/(n-k-1+b);
+        }
+        term *= ratio;
+        s += term;
+        if (term > 1e200) {
+            ls += log(term);
+            s /= term;
+            term = 1;
+        }
+        if (F->get() == 0 && ratio < 1 && term < 1e-17*s) {
+            //binomial terms only shrink past the mode
+            break;
+        }
+    }
+    return lp0 + ls + log(s);
+}
+
+double wfSamplePath::ascertainModern(int min) {
+    int idx = sample_time_vec[sample_time_vec.size()-1]->get_idx();
+    int ss = sample_time_vec[sample_time_vec.size()-1]->get_ss();
+    double y = trajectory.at(idx);
+    if (y == modern_y && F->get() == modern_F && min == modern_min) {
+        return modern_pA;
+    }
+    //P(min <= k < ss)
+    double p = (1.0-cos(y))/2.0;
+    double pA;
+    if (p == 0) {
+        pA = (min <= 0) ? 0 : -INFINITY;
+    } else if (p == 1 || min >= ss) {
+        pA = -INFINITY;
+    } else if (F->get() == 0) {
+        //binomial: P(k >= min) = I_p(min, ss-min+1), then take off P(k == ss) = p^ss
+        double lI = 0;
+        if (min > 0) {
+            if (min != modern_lbeta_min || ss != modern_lbeta_ss) {
+                modern_lbeta = lgamma(min)+lgamma(ss-min+1)-lgamma(ss+1);
+                modern_lbeta_min = min;
+                modern_lbeta_ss = ss;
+            }
+            lI = log_incomplete_beta(min, ss-min+1, p, modern_lbeta);
+        }
+        double lpn = ss*log(p);
+        if (lpn-lI > -0.6931472) {
+            //most of the tail is k == ss, so the subtraction would cancel
+            pA = logTailSum(std::max(min,0), ss, y);
         } else {
-            pNone += 0;
+            pA = lI + log1p(-exp(lpn-lI));
         }
+    } else {
+        //beta binomial
+        pA = logTailSum(std::max(min,0), ss, y);
     }
+    modern_y = y;
+    modern_F = F->get();
+    modern_min = min;
+    modern_pA = pA;
+    return pA;
+}
+
+//uses the terms cached by sampleLogLik, so that has to be called first
+double wfSamplePath::ascertainAncient() {
+    double pNone = none_sum.get();
     double pA;
     if (pNone < 0) {
         //1 - P(all are none)
@@ -317,6 +564,84 @@ double wfSamplePath::ascertainAncient() {
     return pA;
 }
 
+double wfSamplePath::sampleLogLik() {
+    if (F->get() != sample_terms_F || sample_terms.size() != sample_time_vec.size()) {
+        //F changed (or there's no cache yet), so every term changes
+        for (int i = 0; i < sample_terms.size(); i++) {
+            sample_term_log.push_back(std::make_pair(i, sample_terms[i]));
+        }
+        sample_terms.resize(sample_time_vec.size());
+        lnL_sum.clear();
+        none_sum.clear();
+        for (int i = 0; i < sample_time_vec.size(); i++) {
+            sample_terms[i] = computeSampleTerm(i);
+            lnL_sum.add(sample_terms[i].lnL);
+            none_sum.add(sample_terms[i].none);
+        }
+        sample_terms_F = F->get();
+    } else {
+        for (int j = 0; j < dirty_samples.size(); j++) {
+            int i = dirty_samples[j];
+            sample_term_log.push_back(std::make_pair(i, sample_terms[i]));
+            setSampleTerm(i, computeSampleTerm(i));
+        }
+    }
+    for (int j = 0; j < dirty_samples.size(); j++) {
+        sample_dirty[dirty_samples[j]] = 0;
+    }
+    dirty_samples.resize(0);
+    return lnL_sum.get();
+}
+
+wfSamplePath::sample_term wfSamplePath::computeSampleTerm(int i) {
+    sample_term st;
+    st.lnL = sampleProb(i);
+    st.none = 0;
+    int idx = sample_time_vec[i]->get_idx();
+    if (cache_none && i < sample_time_vec.size()-1 && idx > origin) {
+        //P(current time has 0 derived alleles)
+        st.none = sampleProb(0,sample_time_vec[i]->get_ss(),trajectory[idx],0);
+    }
+    return st;
+}
+
+void wfSamplePath::setSampleTerm(int i, const sample_term& st) {
+    lnL_sum.remove(sample_terms[i].lnL);
+    none_sum.remove(sample_terms[i].none);
+    sample_terms[i] = st;
+    lnL_sum.add(st.lnL);
+    none_sum.add(st.none);
+}
+
+void wfSamplePath::markSample(int i) {
+    if (!sample_dirty[i]) {
+        sample_dirty[i] = 1;
+        dirty_samples.push_back(i);
+    }
+}
+
+void wfSamplePath::commitSampleLogLik() {
+    sample_term_log.resize(0);
+    old_lnL_sum = lnL_sum;
+    old_none_sum = none_sum;
+    old_sample_terms_F = sample_terms_F;
+}
+
+void wfSamplePath::rollbackSampleLogLik() {
+    //undo in reverse order, so a term overwritten twice ends up with its oldest value
+    for (int j = sample_term_log.size()-1; j >= 0; j--) {
+        sample_terms[sample_term_log[j].first] = sample_term_log[j].second;
+    }
+    sample_term_log.resize(0);
+    lnL_sum = old_lnL_sum;
+    none_sum = old_none_sum;
+    sample_terms_F = old_sample_terms_F;
+    for (int j = 0; j < dirty_samples.size(); j++) {
+        sample_dirty[dirty_samples[j]] = 0;
+    }
+    dirty_samples.resize(0);
+}
+
 std::vector<double> wfSamplePath::sampleProb() {
 	std::vector<double> sp(0);
 	for (int i = 0; i < sample_time_vec.size(); i++) {
@@ -326,18 +651,22 @@ std::vector<double> wfSamplePath::sampleProb() {
 }
 
 void wfSamplePath::print_traj(std::ostream& o) {
-	int i;
-	for (i = 0; i < trajectory.size(); i++) {
-		o << (1.0-cos(trajectory[i]))/2.0 << " ";
+	text_buffer line;
+	for (int i = origin; i < trajectory.size(); i++) {
+		line.add((1.0-cos(trajectory[i]))/2.0, o.precision());
+		line.add(' ');
 	}
+	line.write_to(o);
 	o << std::endl;
 }
 
 void wfSamplePath::print_traj(ogzstream& o) {
-    int i;
-    for (i = 0; i < trajectory.size(); i++) {
-        o << (1.0-cos(trajectory[i]))/2.0 << " ";
+    text_buffer line;
+    for (int i = origin; i < trajectory.size(); i++) {
+        line.add((1.0-cos(trajectory[i]))/2.0, o.precision());
+        line.add(' ');
     }
+    line.write_to(o);
     o << std::endl;
 }
 
@@ -350,6 +679,16 @@ wfSamplePath::wfSamplePath(std::vector<sample_time*>& st, popsize* p, wfMeasure*
     sample_time_vec = st;
     
     int num_samples = st.size();
+    for (int i = 0; i < num_samples; i++) {
+        sample_time_vec[i]->set_sample_index(i);
+    }
+    sample_dirty.assign(num_samples, 0);
+    sample_terms_F = NAN;
+    old_sample_terms_F = NAN;
+    cache_none = 0;
+    modern_F = NAN;
+    modern_lbeta_min = -1;
+    modern_lbeta_ss = -1;
     
     //Initialize path
     std::vector<double> initial_data(num_samples);
@@ -360,6 +699,9 @@ wfSamplePath::wfSamplePath(std::vector<sample_time*>& st, popsize* p, wfMeasure*
         if (first_nonzero == -INFINITY && sample_time_vec[i]->get_sc() != 0) {
             first_nonzero = sample_time_vec[i]->get();
         }
+        if (sample_time_vec[i]->get_sc() != 0) {
+            nonzero_times.insert(sample_time_vec[i]->get());
+        }
     }
     
     std::cout << "First nonzero timepoint is " << first_nonzero << std::endl;
@@ -388,7 +730,7 @@ wfSamplePath::wfSamplePath(std::vector<sample_time*>& st, popsize* p, wfMeasure*
     breakPoints.resize( std::distance(breakPoints.begin(), it) );
     
     //create the time vector
-    double dt = s.get_dt();
+    grid_spacing spacing(s.get_dt(), s.get_grid_adapt());
     int min_steps = s.get_grid();
     int cur_end_ind = 0;
     int curBreakStart = 0;
@@ -405,29 +747,12 @@ wfSamplePath::wfSamplePath(std::vector<sample_time*>& st, popsize* p, wfMeasure*
     std::vector<double> time_vec;
     time_vec.resize(0);
     time_vec.push_back(breakPoints[startBreak]);
-    double curStart;
     double curEnd;
     for (int curBreak = startBreak; curBreak < breakPoints.size()-1; curBreak++) {
         //make sure the time vector includes all the break points
-        curStart = breakPoints[curBreak];
         curEnd = breakPoints[curBreak+1];
-        int steps = (curEnd-curStart)/s.get_dt()+1;
-        if (steps < min_steps) {
-            steps = min_steps;
-        }
-        steps += 1;
-        dt = (curEnd-curStart)/(steps-1);
-        if (dt < 2*std::numeric_limits<double>::epsilon()) {
-            dt = 2*std::numeric_limits<double>::epsilon();
-            steps = (curEnd-curStart)/dt+1;
-        }
-        cur_end_ind++;
-        int end_k = time_vec.size()-1+steps;
-        for (int k = time_vec.size(); k < end_k; k++) {
-            time_vec.push_back(time_vec[k-1]+dt);
-            cur_end_ind++;
-        }
-        time_vec[time_vec.size()-1] = curEnd;
+        spacing.set_ends(time_vec[0], wf->fisher(initial_data[curBreakStart]), sample_time_vec[cur_time_idx]->get(), wf->fisher(initial_data[curBreakStart+1]));
+        cur_end_ind += extend_grid(time_vec, curEnd, spacing, min_steps);
         //if we hit the time of a data point, simulate path between the two data points
         if (curEnd == sample_time_vec[cur_time_idx]->get()) {
             nextPath = new path(wf->fisher(initial_data[curBreakStart]), wf->fisher(initial_data[curBreakStart+1]), time_vec[0], time_vec[time_vec.size()-1], wf, time_vec);
@@ -436,7 +761,7 @@ wfSamplePath::wfSamplePath(std::vector<sample_time*>& st, popsize* p, wfMeasure*
             } else {
                 this->append(nextPath,1);
             }
-            sample_time_vec[cur_time_idx]->set_idx(cur_end_ind-1);
+            sample_time_vec[cur_time_idx]->set_idx(cur_end_ind);
             cur_time_idx++;
             curBreakStart++;
             delete nextPath;
@@ -444,63 +769,146 @@ wfSamplePath::wfSamplePath(std::vector<sample_time*>& st, popsize* p, wfMeasure*
             time_vec.push_back(curEnd);
             
         } 
-        cur_end_ind--;
     }
     
     std::cout << "Finished creating initial path" << std::endl;
 }
 
+//x at time t, linearly interpolated between the points of traj
+static double interpolate(const std::vector<double>& traj, const std::vector<double>& traj_time, double t) {
+    if (t <= traj_time[0]) {
+        return traj[0];
+    }
+    if (t >= traj_time[traj_time.size()-1]) {
+        return traj[traj.size()-1];
+    }
+    int j = std::upper_bound(traj_time.begin(), traj_time.end(), t)-traj_time.begin()-1;
+    double w = (t-traj_time[j])/(traj_time[j+1]-traj_time[j]);
+    return (1-w)*traj[j]+w*traj[j+1];
+}
+
+void wfSamplePath::warm_start(const std::vector<double>& traj, const std::vector<double>& traj_time, double start, settings& s) {
+    double end = traj_time[traj_time.size()-1];
+    
+    //the same times the constructor makes sure are in the grid, from the start of the old path on
+    std::vector<double> breakPoints;
+    breakPoints.push_back(start);
+    for (int i = 0; i < sample_time_vec.size(); i++) {
+        double t[3] = {sample_time_vec[i]->get_youngest(), sample_time_vec[i]->get(), sample_time_vec[i]->get_oldest()};
+        for (int k = 0; k < 3; k++) {
+            if (t[k] > start) {
+                breakPoints.push_back(t[k]);
+            }
+        }
+    }
+    std::vector<double> curBreaks = myPop->getBreakTimes(start, end);
+    for (int i = 1; i < curBreaks.size(); i++) {
+        breakPoints.push_back(curBreaks[i]);
+    }
+    std::sort(breakPoints.begin(), breakPoints.end());
+    std::vector<double>::iterator it = std::unique(breakPoints.begin(), breakPoints.end());
+    breakPoints.resize( std::distance(breakPoints.begin(), it) );
+    
+    grid_spacing spacing(s.get_dt(), s.get_grid_adapt());
+    spacing.set_ends(start, interpolate(traj, traj_time, start), end, traj[traj.size()-1]);
+    std::vector<double> time_vec(1, start);
+    for (int i = 1; i < breakPoints.size(); i++) {
+        extend_grid(time_vec, breakPoints[i], spacing, s.get_grid());
+    }
+    
+    //the old trajectory, linearly interpolated onto the new grid
+    set_grid(time_vec);
+    for (int i = 0; i < time_vec.size(); i++) {
+        trajectory[i] = interpolate(traj, traj_time, time_vec[i]);
+    }
+    
+    allele_age = start;
+    nonzero_times.clear();
+    for (int i = 0; i < sample_time_vec.size(); i++) {
+        if (sample_time_vec[i]->get() < start) {
+            sample_time_vec[i]->set_idx(-1);
+        } else {
+            sample_time_vec[i]->set_idx(std::lower_bound(time.begin(), time.end(), sample_time_vec[i]->get())-time.begin());
+        }
+        if (sample_time_vec[i]->get_sc() != 0) {
+            nonzero_times.insert(sample_time_vec[i]->get());
+        }
+        markSample(i);
+    }
+    first_nonzero = nonzero_times.size() ? *nonzero_times.begin() : -INFINITY;
+}
+
 
 wfSamplePath::~wfSamplePath() {
 	delete myPop;
 }
 
 void wfSamplePath::set_allele_age(double a, path* p, int i) {
-    int oldLength = time.size();
-    double endTimeUpdate = p->get_time(p->get_length()-1);
+    //p replaces elements 0..i of the path. Only that prefix of the storage is touched: the
+    //rest of the path stays put and origin moves to wherever the new beginning starts
+    int newLength = p->get_length();
+    double endTimeUpdate = p->get_time(newLength-1);
 	old_age = allele_age;
 	allele_age = a;
-	old_begin_traj = this->get_traj(0,i);
-	old_begin_time = this->get_time(0,i);
-	std::vector<double> tempTraj = p->get_traj();
-	std::vector<double> tempTime = p->get_time();
-	old_index = tempTime.size() - 1; 
-	for (int j = i+1; j < trajectory.size(); j++) {
-		tempTraj.push_back(trajectory[j]);
-		tempTime.push_back(time[j]);
-	}
-	trajectory = tempTraj;
-	time = tempTime;
-    int newLength = time.size();
-    int lengthDif = newLength - oldLength;
+	old_begin_traj.assign(trajectory.begin()+origin, trajectory.begin()+origin+i+1);
+	old_begin_time.assign(time.begin()+origin, time.begin()+origin+i+1);
+    int newOrigin = origin + i+1 - newLength;
+    if (newOrigin < 0) {
+        //out of headroom, so everything moves once
+        int shift = grow_front(-newOrigin);
+        newOrigin += shift;
+        for (int j = 0; j < sample_time_vec.size(); j++) {
+            sample_time_vec[j]->shift_idx(shift);
+        }
+    }
+    origin = newOrigin;
+    std::copy(p->get_traj_iterator(0), p->get_traj_iterator(newLength), trajectory.begin()+origin);
+    std::copy(p->get_time_iterator(0), p->get_time_iterator(newLength), time.begin()+origin);
+	old_index = newLength - 1;
+	old_grid_version = grid_version;
+	new_grid_version();
     
     //go through sample times to update index
+    //sample times after the new beginning keep their place in the storage, so they are left alone
     std::vector<double>::iterator search_it;
-    int new_idx;
+    std::vector<double>::iterator begin_it = time.begin()+origin;
+    std::vector<double>::iterator end_it = begin_it+newLength;
     for (int j = 0; j < sample_time_vec.size(); j++) {
         if (sample_time_vec[j]->get() < allele_age) {
             //if it's older than the allele age, just set idx to -1
             sample_time_vec[j]->set_idx(-1);
         } else if (sample_time_vec[j]->get() <= endTimeUpdate) {
             //if it's part of the new trajectory, find where it is
-            search_it = std::lower_bound(time.begin(),time.end(),sample_time_vec[j]->get());
-            if (search_it == time.end() && sample_time_vec[j]->get() != time[time.size()-1]) {
+            search_it = std::lower_bound(begin_it,end_it,sample_time_vec[j]->get());
+            if (search_it == end_it) {
                 std::cerr << "ERROR: could not find sample time index " << j << " with value " << sample_time_vec[j]->get() << " in time vector!" << std::endl;
                 exit(1);
             }
-            new_idx = search_it-time.begin();
-            sample_time_vec[j]->set_idx(new_idx);
-        } else {
-            //otherwise, just update the position by adding!
-            new_idx = sample_time_vec[j]->get_idx() + lengthDif;
-            sample_time_vec[j]->set_idx(new_idx);
+            sample_time_vec[j]->set_idx(search_it-time.begin());
+        }
+        if (sample_time_vec[j]->get() <= endTimeUpdate) {
+            markSample(j);
         }
-
     }
 }
 
 
 
+void wfSamplePath::modify(path* p, int i) {
+    path::modify(p, i);
+    if (p == NULL) {
+        return;
+    }
+    int first = origin+i;
+    int last = first+p->get_length();
+    for (int j = 0; j < sample_time_vec.size(); j++) {
+        int idx = sample_time_vec[j]->get_idx();
+        if (idx >= first && idx < last) {
+            markSample(j);
+        }
+    }
+}
+
 void wfSamplePath::resetIntermediate() {
     //check some things
     if (update_begin) {
@@ -512,10 +920,12 @@ void wfSamplePath::resetIntermediate() {
         exit(1);
     }
     //replace the trajectory
+    int k = origin+old_index;
     for (int j = 0; j < old_trajectory.size(); j++) {
-        trajectory[old_index+j] = old_trajectory[j];
-        time[old_index+j] = old_time[j];
+        trajectory[k+j] = old_trajectory[j];
+        time[k+j] = old_time[j];
     }
+    grid_version = old_grid_version;
     old_index = -1;
 }
 
@@ -526,27 +936,30 @@ void wfSamplePath::resetBeginning() {
         exit(1);
     }
     
-    //prepend the old begining to the rest of the path
+    //put the old begining back in front of the rest of the path
     allele_age = old_age;
-    std::vector<double> tempTraj = old_begin_traj;
-    std::vector<double> tempTime = old_begin_time;
-    for (int j = old_index+1; j < trajectory.size(); j++) {
-        tempTraj.push_back(trajectory[j]);
-        tempTime.push_back(time[j]);
-    }
-    trajectory = tempTraj;
-    time = tempTime;
+    origin += old_index+1 - old_begin_traj.size();
+    std::copy(old_begin_traj.begin(), old_begin_traj.end(), trajectory.begin()+origin);
+    std::copy(old_begin_time.begin(), old_begin_time.end(), time.begin()+origin);
+    grid_version = old_grid_version;
         
-    //also reset all the indices of the sample times
+    //also reset the indices of the sample times that set_allele_age touched
+    double endTimeUpdate = old_begin_time[old_begin_time.size()-1];
     for (int i = 0; i < sample_time_vec.size(); i++) {
-        sample_time_vec[i]->reset_idx();
+        if (sample_time_vec[i]->get() <= endTimeUpdate) {
+            sample_time_vec[i]->reset_idx();
+        }
     }
     
     update_begin = 0;
 }
 
 int wfSamplePath::get_sampleTime(int i) {
-    return sample_time_vec[i]->get_idx();
+    int idx = sample_time_vec[i]->get_idx();
+    if (idx == -1) {
+        return -1;
+    }
+    return idx-origin;
 }
 
 double wfSamplePath::get_sampleSize(int i) {
@@ -575,26 +988,48 @@ sample_time* wfSamplePath::get_sampleTimeObj(int i) {
 
 void wfSamplePath::updateFirstNonzero(double t, double old_t) {
     old_first_nonzero = first_nonzero;
-    if (t < old_first_nonzero || old_first_nonzero == old_t) {
-        first_nonzero = t;
-    }
+    nonzero_times.erase(nonzero_times.find(old_t));
+    nonzero_times.insert(t);
+    moved_from = old_t;
+    moved_to = t;
+    first_nonzero = std::min(*nonzero_times.begin(), 0.0);
 }
 
-void wfSamplePath::updateFirstNonzero() {
-    old_first_nonzero = first_nonzero;
-    first_nonzero = 0;
-    for (int i = 0; i < sample_time_vec.size(); i++) {
-        if (sample_time_vec[i]->get_sc() > 0 && sample_time_vec[i]->get() < first_nonzero) {
-            first_nonzero = sample_time_vec[i]->get();
-        } else {
-        }
-    }
+void wfSamplePath::resetFirstNonzero() {
+    nonzero_times.erase(nonzero_times.find(moved_to));
+    nonzero_times.insert(moved_from);
+    first_nonzero = old_first_nonzero;
 }
 
-void path::replace_time(std::vector<double> new_time) {
-	if (new_time.size() != time.size()) {
+void path::replace_time(const std::vector<double>& new_time) {
+	if (new_time.size() != get_length_time()) {
 		std::cerr << "ERROR: Trying to replace a time vector with one of a different size!" << std::endl;
 		exit(1);
 	}
-	time = new_time;
+	std::copy(new_time.begin(), new_time.end(), time.begin()+origin);
+	new_grid_version();
+}
+
+void path::set_grid(const std::vector<double>& new_time) {
+	time.assign(new_time.begin(), new_time.end());
+	trajectory.resize(new_time.size());
+	origin = 0;
+	new_grid_version();
+}
+
+void path::clear() {
+	trajectory.resize(0);
+	time.resize(0);
+	origin = 0;
+	old_index = -1;
+	new_grid_version();
+}
+
+int path::grow_front(int n) {
+	//leave some slack so that a run of older allele ages doesn't regrow every time
+	int shift = n + get_length()/4;
+	trajectory.insert(trajectory.begin(), shift, 0);
+	time.insert(time.begin(), shift, 0);
+	origin += shift;
+	return shift;
 }
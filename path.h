@@ -14,6 +14,7 @@
 
 #include "gzstream.h"
 #include <vector>
+#include <set>
 #include <string>
 #include <iostream>
 #include "math.h"
@@ -26,39 +27,68 @@ class sample_time;
 class MbRandom;
 class param_F;
 
+//How far apart the points of a new time grid are: -d, max_dt, everywhere, or with -x adaptive,
+//closer near an end of the path where the frequency is close to 1, where the drift (cot(x)) blows
+//up. There the spacing is adaptive times the scale of (pi-x)^2, which is its value at the end plus
+//the time from it, down to max_dt/64 at the end itself.
+class grid_spacing {
+public:
+	grid_spacing(double m, double a = 0);
+	void set_ends(double t0, double x0, double t, double xt); //the path goes from x0 at t0 to xt at t
+	double at(double t);
+	double get_max_dt() {return max_dt;};
+	bool is_adaptive() {return adaptive > 0;};
+
+private:
+	double max_dt;
+	double adaptive;
+	double ta; //the ends, with (pi-x)^2 at each
+	double sa;
+	double tb;
+	double sb;
+};
+
 class path {
 
 public:
 	//constructor
-	path() {trajectory.resize(0); time.resize(0); old_index = -1; old_trajectory.resize(0); old_time.resize(0);}; 
+	path() {trajectory.resize(0); time.resize(0); origin = 0; old_index = -1; old_trajectory.resize(0); old_time.resize(0); grid_version = old_grid_version = grid_counter = 0;}; 
 	path(double x0, double xt, double t0, double t, measure* m, settings& s);
-	path(std::vector<double>& p, std::vector<double>& t) {trajectory = p; time = t;};
+	path(std::vector<double>& p, std::vector<double>& t) {trajectory = p; time = t; origin = 0; grid_version = old_grid_version = grid_counter = 0;};
 	path(double x0, double xt, double t0, double t, measure* m, std::vector<double>& tvec);
+	virtual ~path() {}; //param_path deletes its wfSamplePath through a path*
+	static void time_grid(double t0, double t, settings& s, std::vector<double>& time); //the times path(x0, xt, t0, t, m, s) uses
+	static int extend_grid(std::vector<double>& time, double t, grid_spacing& h, int min_steps); //appends a grid from time's last point to t, with at least min_steps steps; returns how many points it added
 
 	
 	//element access
-	std::vector<double> get_traj() {return trajectory;};
-	double get_traj(int i) {return trajectory.at(i);};
+	std::vector<double> get_traj() {return std::vector<double>(trajectory.begin()+origin,trajectory.end());};
+	double get_traj(int i) {return trajectory.at(origin+i);};
 	std::vector<double> get_traj(int i, int j);
-	void set_traj(double x, int i) {trajectory.at(i) = x;};
-	std::vector<double> get_time() {return time;};
-    std::vector<double>& get_time_ref() {return time;};
-	double get_time(int i) {return time.at(i);};
+	void set_traj(double x, int i) {trajectory.at(origin+i) = x;};
+	std::vector<double> get_time() {return std::vector<double>(time.begin()+origin,time.end());};
+	double get_time(int i) {return time.at(origin+i);};
 	std::vector<double> get_time(int i, int j);
-	double get_length() {return trajectory.size();};
-    double get_length_time() {return time.size();};
-	std::vector<double>::iterator get_traj_iterator(int i) {return trajectory.begin()+i;};
-	std::vector<double>::iterator get_time_iterator(int i) {return time.begin()+i;};
+	void get_time(int i, int j, std::vector<double>& timeSlice); //same, but fills timeSlice
+	double get_length() {return trajectory.size()-origin;};
+    double get_length_time() {return time.size()-origin;};
+	std::vector<double>::iterator get_traj_iterator(int i) {return trajectory.begin()+origin+i;};
+	std::vector<double>::iterator get_time_iterator(int i) {return time.begin()+origin+i;};
+	int get_origin() {return origin;}; //position of element 0 in the underlying storage
+	unsigned long get_grid_version() {return grid_version;}; //changes whenever the time grid does
 	path* extract_path(int i, int j);
+	void extract_path(int i, int j, path* p); //same, but overwrites p
 	
 	//element modification
 	void flipCbp();
 	void append(path* p); //adds the elements of p to the end of the current path
 	void append(path* p, int i); //adds the elements of p starting with the ith element of p
 	void insert(path* p, int i); //inserts the elements of p into the current path starting at index i of current path
-	void modify(path* p, int i); //replaces current path with the elements of p starting at index i of current path
+	virtual void modify(path* p, int i); //replaces current path with the elements of p starting at index i of current path
 	virtual void reset(); //resets back to the stuff detailed in old_trajectory and old_time, starting from old_index
-	void replace_time(std::vector<double> new_time); 
+	void replace_time(const std::vector<double>& new_time); 
+	void set_grid(const std::vector<double>& new_time); //lays the path on a new time vector. Trajectory must be filled in afterwards!
+	void clear(); //empties the path, but keeps the storage so it can be reused
 	
 	//I/O
 	void print(std::ostream& o = std::cout);
@@ -73,11 +103,31 @@ public:
 protected:
 	//store the trajectory and the times
 	//trajectory[i] corresponds to position at time[i]
+	//NB: the path starts at trajectory[origin]. Everything before that is unused headroom, so that
+	//the ancient end of the path can be swapped out without moving the rest of it
 	std::vector<double> trajectory;
 	std::vector<double> time;	
+	int origin;
+	int grow_front(int n); //adds at least n slots of headroom, returns how far the storage moved
 	int old_index;
 	std::vector<double> old_trajectory;
 	std::vector<double> old_time;
+	//every time grid the path has had gets its own number, and a reset goes back to the old number
+	unsigned long grid_version;
+	unsigned long old_grid_version;
+	unsigned long grid_counter;
+	void new_grid_version() {grid_version = ++grid_counter;};
+};
+
+//running sum of log probabilities that keeps -inf terms out of the total, so they can be taken out again
+struct log_sum {
+    double finite;
+    int ninf;
+    log_sum() {clear();};
+    void clear() {finite = 0; ninf = 0;};
+    void add(double x) {if (x == -INFINITY) ninf++; else finite += x;};
+    void remove(double x) {if (x == -INFINITY) ninf--; else finite -= x;};
+    double get() {return (ninf > 0) ? -INFINITY : finite;};
 };
 
 //derived class that also has sample times and sample frequencies
@@ -94,7 +144,7 @@ public:
 	
 	//access sample aspects
 	int get_num_samples() {return sample_time_vec.size();};
-	int get_sampleTime(int i); //NOTE: RETURNS AN INDEX!
+	int get_sampleTime(int i); //NOTE: RETURNS AN INDEX! (into the path, not the storage)
 	double get_sampleSize(int i);
 	double get_sampleCount(int i);
 	double get_sampleFreq(int i);
@@ -103,15 +153,21 @@ public:
     sample_time* get_sampleTimeObj(int i);
     
     //change sample aspects
-    void updateFirstNonzero(double t, double old_t);
-    void updateFirstNonzero();
-    void resetFirstNonzero() {first_nonzero=old_first_nonzero;};
+    void updateFirstNonzero(double t, double old_t); //a sample with nonzero count moved from old_t to t
+    void resetFirstNonzero(); //undoes the last updateFirstNonzero
+	
+	//start from the state of an earlier run instead: traj (in x) at times traj_time, interpolated
+	//onto a new grid of the current -d from time start on. The sample times have to be set first
+	void warm_start(const std::vector<double>& traj, const std::vector<double>& traj_time, double start, settings& s);
 	
 	//for allele age stuff
 	void set_allele_age(double a, path* p, int i); //this should set the allele age, prepend the new path starting at CURRENT i, and fix up sampleTime. 
 	void set_update_begin(bool up = 1) {update_begin = up;}; //use this in the propose thing
 	double get_allele_age() {return allele_age;};
 	
+	//modify also marks the samples in the window, so their likelihood is recomputed
+	void modify(path* p, int i);
+	
 	//reset the interior portion of the path
     void resetIntermediate();
     //reset the beginning of the path
@@ -119,10 +175,16 @@ public:
     
 	//sample probabilities
     double sampleProb(int k, int n, double y);
+    double sampleProb(int k, int n, double y, double lchoose); //lchoose = log(n choose k)
 	double sampleProb(int i);
 	std::vector<double> sampleProb();
+    double sampleLogLik(); //sum of sampleProb(i) over all samples, only recomputing the marked ones
+    void markSample(int i); //sample i moved or the path under it changed
+    void commitSampleLogLik(); //proposal accepted
+    void rollbackSampleLogLik(); //proposal rejected, go back to the cache as of the last commit
     
     //ascertainment
+    void set_ascertain(bool a) {cache_none = a;}; //keep the terms ascertainAncient needs in the cache
     double ascertainModern(int min);
     double ascertainAncient();
     
@@ -149,6 +211,38 @@ private:
 	std::vector<double> old_begin_time; //The times from the old beginning
 	double first_nonzero; //the first sample time where there are more than 0 copies of the derived allele
     double old_first_nonzero;
+    std::multiset<double> nonzero_times; //current times of all the samples with nonzero count, oldest first
+    double moved_from; //the last change made to nonzero_times, so it can be undone
+    double moved_to;
+    
+    //cached sample likelihood
+    struct sample_term {
+        double lnL; //sampleProb(i)
+        double none; //log P(no derived alleles in sample i), for the ascertainment correction
+    };
+    std::vector<sample_term> sample_terms; //as of the last time sample i was recomputed
+    std::vector<char> sample_dirty; //is sample i marked?
+    std::vector<int> dirty_samples; //the marked samples
+    std::vector<std::pair<int,sample_term> > sample_term_log; //terms overwritten since the last commit, with their old values
+    log_sum lnL_sum;
+    log_sum none_sum;
+    log_sum old_lnL_sum;
+    log_sum old_none_sum;
+    double sample_terms_F; //F the cache was computed with, NAN if there is no cache
+    double old_sample_terms_F;
+    bool cache_none; //also keep the ascertainment terms
+    sample_term computeSampleTerm(int i);
+    void setSampleTerm(int i, const sample_term& st);
+
+    //the modern ascertainment term for the last trajectory value and F it was computed with
+    double modern_y;
+    double modern_F;
+    int modern_min;
+    double modern_pA;
+    double modern_lbeta; //log B(min, ss-min+1)
+    int modern_lbeta_min;
+    int modern_lbeta_ss;
+    double logTailSum(int m, int n, double y);
 	
 	//parses comma separated list of parameters
 	std::vector<double> parse_comma_sep(char* c);
@@ -159,6 +253,7 @@ private:
     //for sorting input
     std::vector<int> orderTimeIndex();
     std::vector<double> sortByIndex(std::vector<double>& vec, std::vector<int> index);
+    double logBetaBinomialRatio(int k, int n, double a, double b);
     
 	
 	//the population size history
@@ -32,7 +32,13 @@ read.path = function(outname,n=-1L) {
 	traj = readLines(paste(outname,".traj",sep=""),n=n)
 	traj = lapply(traj, function(x) {temp = as.numeric(unlist(strsplit(x,split=" "))); temp[2:length(temp)]})
 	time = readLines(paste(outname,".time",sep=""),n=n)
-	time = lapply(time, function(x) {temp = as.numeric(unlist(strsplit(x,split=" "))); temp[2:length(temp)]})
+	time = lapply(time, function(x) {temp = as.numeric(unlist(strsplit(x,split=" "))); temp[-1]})
+	#a line with just the generation means the time grid is the same as on the line before
+	for (i in seq_along(time)) {
+		if (length(time[[i]]) == 0) {
+			time[[i]] = time[[i-1]]
+		}
+	}
 	return(list(traj=traj,time=time))
 }
 
@@ -17,13 +17,20 @@
 
 
 popsize::popsize(settings& s) {
+	read(s, s.get_popFile());
+}
+
+popsize::popsize(settings& s, std::string pop_size_file) {
+	read(s, pop_size_file);
+}
+
+void popsize::read(settings& s, std::string pop_size_file) {
 	sizes.resize(0);
 	sizes.push_back(0);
 	rates.resize(0);
 	rates.push_back(0);
 	times.resize(0);
 	times.push_back(0);
-    std::string pop_size_file = s.get_popFile();
 	std::ifstream popFile(pop_size_file.c_str());
 	std::string curLineString;
 	double curSize;
@@ -155,6 +162,13 @@ std::vector<double> popsize::getTau(const std::vector<double>& t_vec) {
 	return tau_vec;
 }
 
+void popsize::getTau(const std::vector<double>& t_vec, std::vector<double>& tau_vec) {
+	tau_vec.resize(t_vec.size());
+	for (int i = 0; i < t_vec.size(); i++) {
+		tau_vec[i] = getTau(t_vec[i]);
+	}
+}
+
 std::vector<double> popsize::getBreakTimes(double t0, double t) {
 	int first_ind;
 	int last_ind;
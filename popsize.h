@@ -22,6 +22,8 @@ class popsize {
 public:
 	//constructor takes in a path to a population size file
 	popsize(settings& s);
+	//the same with another file than the -P one, in the units of the settings
+	popsize(settings& s, std::string pop_size_file);
 	
 	//this gets the popsize at time t. Possibly the left limit
 	double getSize(double t, bool leftLim = 0);
@@ -31,10 +33,14 @@ public:
 	//this gets the transformed time. This is good
 	double getTau(double t);
 	std::vector<double> getTau(const std::vector<double>& t_vec);
+	void getTau(const std::vector<double>& t_vec, std::vector<double>& tau_vec); //same, but fills tau_vec
 	
 	//gets the breakpoints spanned by an interval
 	std::vector<double> getBreakTimes(double t0, double t);
 	
+	//true if there is just one epoch, which is then of constant size from the present back to -INFINITY
+	bool is_constant() {return times.size() == 2;};
+	
 	//get an entry of the vectors
 	double getSizes(int i) {return sizes.at(i);};
 	double getRates(int i) {return rates.at(i);};
@@ -50,8 +56,39 @@ private:
 	std::vector<double> rates; //growth rates in an interval
 	std::vector<double> times; // begining times of intervals
 	
+	void read(settings& s, std::string pop_size_file);
 	void computeT();
 	std::vector<double> T; //these are the integrals over a whole interval
 };
 
+//Demography policies for the likelihood integrators in girsanov.h, which are templated on them.
+//variable_demography asks the popsize for everything. constant_demography is for a popsize with
+//is_constant(): the size never changes, so there's no time derivative and no breakpoints to look up.
+class variable_demography {
+public:
+	static const bool constant = false;
+	variable_demography(popsize* r) {rho = r;};
+	double size(double t, bool leftLim) {return rho->getSize(t, leftLim);};
+	double deriv(double t, bool leftLim) {return rho->getDeriv(t, leftLim);};
+	//the breakpoints spanned by [t0, t], including t0 and t
+	const double* breaks(double t0, double t, int& n) {dconts = rho->getBreakTimes(t0, t); n = dconts.size(); return &dconts[0];};
+	
+private:
+	popsize* rho;
+	std::vector<double> dconts;
+};
+
+class constant_demography {
+public:
+	static const bool constant = true;
+	constant_demography(popsize* r) {N = r->getSizes(1);};
+	double size(double t, bool leftLim) {return N;};
+	double deriv(double t, bool leftLim) {return 0;};
+	const double* breaks(double t0, double t, int& n) {dconts[0] = t0; dconts[1] = t; n = 2; return dconts;};
+	
+private:
+	double N;
+	double dconts[2];
+};
+
 #endif
\ No newline at end of file
@@ -0,0 +1,178 @@
+/*
+ *  reweight.cpp
+ *  Selection_Recombination
+ *
+ */
+
+#include "reweight.h"
+#include "measure.h"
+#include "param.h"
+#include "popsize.h"
+#include "runpaths.h"
+#include "settings.h"
+#include "textbuf.h"
+
+#include <iostream>
+#include <fstream>
+#include <stdlib.h>
+#include "math.h"
+
+//below this fraction of the samples, the effective sample size is too small to trust the weights
+static const double min_ess_fraction = 0.1;
+
+double log_path_weight(path* p, double alpha1, double alpha2, popsize* new_rho, popsize* old_rho) {
+	cbpMeasure cbp(NULL);
+	double lw = cbp.log_girsanov_wf_r(p, alpha1, alpha2, new_rho, 0)-cbp.log_girsanov_wf_r(p, alpha1, alpha2, old_rho, 0);
+	if (isinf(lw)) {
+		return lw;
+	}
+	std::vector<double> time = p->get_time();
+	std::vector<double> new_tau;
+	std::vector<double> old_tau;
+	new_rho->getTau(time, new_tau);
+	old_rho->getTau(time, old_tau);
+	std::vector<double>::iterator x = p->get_traj_iterator(0);
+	for (int i = 0; i < time.size()-1; i++) {
+		double new_dt = new_tau[i+1]-new_tau[i];
+		double old_dt = old_tau[i+1]-old_tau[i];
+		if (x[i+1] == 0 || new_dt == old_dt) {
+			//before the allele arose, or the same under both
+			continue;
+		} else if (x[i] == 0) {
+			//leaving 0, where the ratio of the transition densities has a limit
+			lw += -2*log(new_dt/old_dt)-x[i+1]*x[i+1]/2.0*(1.0/new_dt-1.0/old_dt);
+		} else {
+			lw += cbp.log_transition_density(x[i], x[i+1], new_dt)-cbp.log_transition_density(x[i], x[i+1], old_dt);
+		}
+	}
+	return lw;
+}
+
+void reweight_run(settings& s) {
+	std::string baseName = s.get_surface_input();
+	if (baseName == "") {
+		std::cerr << "ERROR: -V needs the output prefix of the run to reweight, -I" << std::endl;
+		exit(1);
+	}
+	popsize* new_rho = s.parse_popsize_file();
+	popsize* old_rho = new popsize(s, s.get_reweight_pop());
+	double old_scale = s.get_alpha_prior();
+	double new_scale = s.get_new_alpha_prior();
+	bool prior_alpha1 = !s.get_fix_h(); //with -h alpha1 just follows alpha2
+
+	param_reader params;
+	run_traj_reader trajs;
+	open_run(baseName, params, trajs);
+	int alpha1_col = params.find_column("alpha1");
+	int alpha2_col = params.find_column("alpha2");
+	int age_col = params.find_column("age");
+	if (alpha1_col < 0 || alpha2_col < 0) {
+		std::cerr << "ERROR: " << baseName << ".param.gz has no alpha1 and alpha2 columns" << std::endl;
+		exit(1);
+	}
+	std::cerr << "Reweighting " << baseName << " from " << s.get_reweight_pop() << " to " << s.get_popFile()
+	    << " and from prior scale " << old_scale << " to " << new_scale << " on " << s.get_num_threads() << " threads" << std::endl;
+
+	std::vector<int> gens;
+	std::vector<double> log_weights;
+	std::vector<std::vector<double> > kept; //alpha1, alpha2 and the age of each sample
+	int skipped = 0;
+	for_each_run_sample<double>(params, trajs, s.get_burnin(), s.get_num_threads(),
+		[&](path* p, const std::vector<double>& values, double& lw) {
+			double a1 = values[alpha1_col];
+			double a2 = values[alpha2_col];
+			lw = log_path_weight(p, a1, a2, new_rho, old_rho);
+			lw += param_gamma::log_prior(a2, new_scale)-param_gamma::log_prior(a2, old_scale);
+			if (prior_alpha1) {
+				lw += param_gamma::log_prior(a1, new_scale)-param_gamma::log_prior(a1, old_scale);
+			}
+			if (age_col >= 0) {
+				lw += log(new_rho->getSize(values[age_col]))-log(old_rho->getSize(values[age_col]));
+			}
+			return !isnan(lw);
+		},
+		[&](int gen, const std::vector<double>& values, bool ok, double& lw) {
+			if (!ok) {
+				skipped++;
+				return;
+			}
+			gens.push_back(gen);
+			log_weights.push_back(lw);
+			std::vector<double> k;
+			k.push_back(values[alpha1_col]);
+			k.push_back(values[alpha2_col]);
+			k.push_back(age_col >= 0 ? values[age_col] : 0);
+			kept.push_back(k);
+		});
+	if (log_weights.size() == 0) {
+		std::cerr << "ERROR: No samples to reweight" << std::endl;
+		exit(1);
+	}
+
+	//normalized weights and their effective sample size
+	double max_lw = -INFINITY;
+	for (int i = 0; i < log_weights.size(); i++) {
+		if (log_weights[i] > max_lw) {
+			max_lw = log_weights[i];
+		}
+	}
+	if (isinf(max_lw)) {
+		std::cerr << "ERROR: Every sample is impossible under the new population size history" << std::endl;
+		exit(1);
+	}
+	std::vector<double> weights(log_weights.size());
+	double sum = 0;
+	for (int i = 0; i < weights.size(); i++) {
+		weights[i] = exp(log_weights[i]-max_lw);
+		sum += weights[i];
+	}
+	double sum2 = 0;
+	for (int i = 0; i < weights.size(); i++) {
+		weights[i] /= sum;
+		sum2 += weights[i]*weights[i];
+	}
+	double ess = 1.0/sum2;
+
+	std::string fileName = s.get_baseName() + ".reweight";
+	std::ofstream out(fileName.c_str());
+	if (!out) {
+		std::cerr << "ERROR: could not open " << fileName << std::endl;
+		exit(1);
+	}
+	out << "gen\tlog_weight\tweight" << std::endl;
+	text_buffer line;
+	for (int i = 0; i < weights.size(); i++) {
+		line.clear();
+		line.add(gens[i]);
+		line.add('\t');
+		line.add(log_weights[i]);
+		line.add('\t');
+		line.add(weights[i]);
+		line.add('\n');
+		line.write_to(out);
+	}
+	out.close();
+
+	std::cerr << "Weights of " << weights.size() << " samples written to " << fileName;
+	if (skipped > 0) {
+		std::cerr << " (" << skipped << " more couldn't be weighed)";
+	}
+	std::cerr << std::endl;
+	std::cerr << "Effective sample size " << ess << " (" << 100*ess/weights.size() << "% of the samples)" << std::endl;
+	const char* names[] = {"alpha1", "alpha2", "age"};
+	std::cerr << "\tbefore\treweighted" << std::endl;
+	for (int k = 0; k < (age_col >= 0 ? 3 : 2); k++) {
+		double before = 0;
+		double after = 0;
+		for (int i = 0; i < weights.size(); i++) {
+			before += kept[i][k]/weights.size();
+			after += kept[i][k]*weights[i];
+		}
+		std::cerr << names[k] << "\t" << before << "\t" << after << std::endl;
+	}
+	if (ess < min_ess_fraction*weights.size()) {
+		std::cerr << "WARNING: The effective sample size is small; the new posterior is too far from the old one to reweight, and needs a run of its own" << std::endl;
+	}
+	delete new_rho;
+	delete old_rho;
+}
@@ -0,0 +1,33 @@
+/*
+ *  reweight.h
+ *  Selection_Recombination
+ *
+ */
+
+#pragma once
+
+#ifndef reweight_H
+#define reweight_H
+
+class settings;
+class path;
+class popsize;
+
+//-V old_pop_file -I prefix: importance weights that turn the samples of the run with output
+//prefix prefix, which used the population size history old_pop_file and the prior scale -c, into
+//samples from the posterior with the history -P and the prior scale -C. The weight of a sample
+//is the ratio of its density under the two, which is
+//    - the ratio of the Girsanov densities, log_girsanov_wf_r, of its path
+//    - the ratio of the Bessel transition densities between the points of its path, which the
+//      likelihood is relative to, in the time each history gives them
+//    - the ratio of the priors on alpha1, alpha2 and the age
+//(the probability of the data given the path is the same under both, and cancels). The weights
+//are worked out on -J threads, from generation -u on, and written to output_prefix.reweight,
+//with the effective sample size and the reweighted posterior means on std::cerr. -G and -N have
+//to be the ones the run used.
+void reweight_run(settings& s);
+
+//the part of the log weight that comes from the path
+double log_path_weight(path* p, double alpha1, double alpha2, popsize* new_rho, popsize* old_rho);
+
+#endif
@@ -0,0 +1,128 @@
+/*
+ *  runpaths.h
+ *  Selection_Recombination
+ *
+ */
+
+#pragma once
+
+#ifndef runpaths_H
+#define runpaths_H
+
+#include "path.h"
+#include "runreader.h"
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdlib.h>
+#include "math.h"
+
+//Going through the samples of an earlier run as paths, for -L and -V: something is worked out
+//for every sample on worker threads, and handed back in order of generation.
+
+//opens the param file and the trajectories of the run with output prefix baseName, or exits
+inline void open_run(std::string baseName, param_reader& params, run_traj_reader& trajs) {
+	if (!params.open(baseName + ".param.gz")) {
+		std::cerr << "ERROR: could not open " << baseName << ".param.gz" << std::endl;
+		exit(1);
+	}
+	if (!trajs.open(baseName)) {
+		std::cerr << "ERROR: could not open the trajectories of " << baseName << " (was it run with -Q?)" << std::endl;
+		exit(1);
+	}
+}
+
+//exits if either reader stopped on something it couldn't read rather than at the end of the run
+inline void check_run(param_reader& params, run_traj_reader& trajs) {
+	if (params.bad() || trajs.bad()) {
+		std::cerr << "ERROR: " << (params.bad() ? params.get_error() : trajs.get_error()) << std::endl;
+		exit(1);
+	}
+}
+
+//samples read from a run before the threads work on them
+static const int run_batch_size = 1024;
+
+template <class R>
+struct run_batch {
+	std::vector<int> gen;
+	std::vector<std::vector<double> > values; //the param file's columns
+	std::vector<path*> paths;
+	std::vector<R> results;
+	std::vector<char> ok;
+};
+
+//the next run_batch_size samples from generation burnin on; false at the end of the run
+template <class R>
+bool read_run_batch(param_reader& params, run_traj_reader& trajs, int burnin, run_batch<R>& b) {
+	for (int i = 0; i < b.paths.size(); i++) {
+		delete b.paths[i];
+	}
+	b.gen.resize(0);
+	b.values.resize(0);
+	b.paths.resize(0);
+	int gen;
+	int traj_gen;
+	std::vector<double> values;
+	std::vector<double> freq;
+	std::vector<double> time;
+	while (b.paths.size() < run_batch_size && params.next(gen, values)) {
+		if (!trajs.next(traj_gen, freq, time) || traj_gen != gen) {
+			check_run(params, trajs);
+			std::cerr << "ERROR: The trajectories don't match the parameters at generation " << gen << std::endl;
+			exit(1);
+		}
+		if (gen < burnin) {
+			continue;
+		}
+		for (int i = 0; i < freq.size(); i++) {
+			freq[i] = acos(1.0-2.0*freq[i]);
+		}
+		b.gen.push_back(gen);
+		b.values.push_back(values);
+		b.paths.push_back(new path(freq, time));
+	}
+	check_run(params, trajs);
+	b.results.resize(b.paths.size());
+	b.ok.resize(b.paths.size());
+	return b.paths.size() > 0;
+}
+
+//every num_threads-th sample of the batch, from the first
+template <class R, class work_f>
+void work_run_batch(run_batch<R>* b, work_f* work, int first, int num_threads) {
+	for (int i = first; i < b->paths.size(); i += num_threads) {
+		b->ok[i] = (*work)(b->paths[i], b->values[i], b->results[i]);
+	}
+}
+
+//calls work(path*, values, R& result) for each sample from generation burnin on, on num_threads
+//threads, and then collect(gen, values, ok, result) for each one in order, where ok is what work
+//returned. The threads work on one batch while the next one is read.
+template <class R, class work_f, class collect_f>
+void for_each_run_sample(param_reader& params, run_traj_reader& trajs, int burnin, int num_threads, work_f work, collect_f collect) {
+	run_batch<R> batches[2];
+	bool more = read_run_batch(params, trajs, burnin, batches[0]);
+	for (int round = 0; more; round++) {
+		run_batch<R>& cur = batches[round%2];
+		std::vector<std::thread> workers;
+		for (int i = 0; i < num_threads; i++) {
+			workers.push_back(std::thread(work_run_batch<R, work_f>, &cur, &work, i, num_threads));
+		}
+		more = read_run_batch(params, trajs, burnin, batches[(round+1)%2]);
+		for (int i = 0; i < workers.size(); i++) {
+			workers[i].join();
+		}
+		for (int i = 0; i < cur.paths.size(); i++) {
+			collect(cur.gen[i], cur.values[i], cur.ok[i] != 0, cur.results[i]);
+		}
+	}
+	for (int k = 0; k < 2; k++) {
+		for (int i = 0; i < batches[k].paths.size(); i++) {
+			delete batches[k].paths[i];
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,193 @@
+/*
+ *  runreader.cpp
+ *  Selection_Recombination
+ *
+ */
+
+#include "runreader.h"
+#include <stdlib.h>
+#include <sstream>
+#include <algorithm>
+#include "math.h"
+
+bool parse_line(const std::string& line, int& gen, std::vector<double>& values) {
+	values.resize(0);
+	const char* p = line.c_str();
+	char* end;
+	long g = strtol(p, &end, 10);
+	if (end == p) {
+		return false;
+	}
+	gen = g;
+	p = end;
+	while (true) {
+		double v = strtod(p, &end);
+		if (end == p) {
+			break;
+		}
+		values.push_back(v);
+		p = end;
+	}
+	//only whitespace should be left
+	while (*p == ' ' || *p == '\t' || *p == '\r') {
+		p++;
+	}
+	return *p == '\0';
+}
+
+bool param_reader::open(std::string fileName, int bufferSize) {
+	name = fileName;
+	line_num = 1;
+	error = "";
+	in.set_buffer_size(bufferSize);
+	in.open(fileName.c_str());
+	if (!in.good() || !std::getline(in, line)) {
+		return false;
+	}
+	std::istringstream header(line);
+	std::string name;
+	columns.resize(0);
+	header >> name; //gen
+	while (header >> name) {
+		columns.push_back(name);
+	}
+	return true;
+}
+
+int param_reader::find_column(std::string name) {
+	for (int i = 0; i < columns.size(); i++) {
+		if (columns[i] == name) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+bool param_reader::next(int& gen, std::vector<double>& values) {
+	if (error != "" || !std::getline(in, line) || in.eof()) {
+		return false;
+	}
+	line_num++;
+	if (!parse_line(line, gen, values) || values.size() != columns.size()) {
+		std::ostringstream msg;
+		msg << name << " line " << line_num << " isn't the generation and " << columns.size() << " numbers";
+		error = msg.str();
+		return false;
+	}
+	return true;
+}
+
+bool run_traj_reader::open(std::string baseName, int bufferSize) {
+	name = baseName;
+	num_read = 0;
+	error = "";
+	std::string binName = baseName + ".traj.bin";
+	FILE* test = fopen(binName.c_str(), "rb");
+	if (test != NULL) {
+		fclose(test);
+		binary = true;
+		return bin.open(binName);
+	}
+	binary = false;
+	have_time = false;
+	std::string trajName = baseName + ".traj.gz";
+	std::string timeName = baseName + ".time.gz";
+	trajFile.set_buffer_size(bufferSize);
+	timeFile.set_buffer_size(bufferSize);
+	trajFile.open(trajName.c_str());
+	timeFile.open(timeName.c_str());
+	return trajFile.good() && timeFile.good();
+}
+
+bool run_traj_reader::next(int& gen, std::vector<double>& freq, std::vector<double>& time) {
+	if (error != "") {
+		return false;
+	}
+	if (binary) {
+		//incomplete records were already left out when the file was opened
+		num_read++;
+		if (!bin.next(gen, freq, time)) {
+			if (num_read <= bin.get_num_records()) {
+				fail(".traj.bin", "can't be read");
+			}
+			return false;
+		}
+		return true;
+	}
+	//the two files are written separately, so a stopped run can leave one ahead of the other
+	if (!std::getline(trajFile, trajLine) || !std::getline(timeFile, timeLine) || trajFile.eof() || timeFile.eof()) {
+		return false;
+	}
+	num_read++;
+	int time_gen;
+	if (!parse_line(trajLine, gen, freq)) {
+		return fail(".traj.gz", "isn't a list of numbers");
+	}
+	if (!parse_line(timeLine, time_gen, time)) {
+		return fail(".time.gz", "isn't a list of numbers");
+	}
+	if (time_gen != gen) {
+		return fail(".time.gz", "is for a different generation than .traj.gz");
+	}
+	if (time.size() == 0) {
+		//same grid as the line before
+		if (!have_time) {
+			return fail(".time.gz", "has no times and there's no line before it");
+		}
+		time = last_time;
+	} else {
+		last_time = time;
+		have_time = true;
+	}
+	if (freq.size() != time.size()) {
+		return fail(".traj.gz", "has a different length than in .time.gz");
+	}
+	return true;
+}
+
+bool run_traj_reader::fail(std::string file, std::string why) {
+	std::ostringstream msg;
+	msg << name << file << (binary ? " record " : " line ") << num_read << " " << why;
+	error = msg.str();
+	return false;
+}
+
+column_summary summarize_column(std::vector<double>& values, double level) {
+	column_summary s;
+	int n = values.size();
+	s.mean = NAN;
+	s.sd = NAN;
+	s.hpd_lower = NAN;
+	s.hpd_upper = NAN;
+	if (n == 0) {
+		return s;
+	}
+	double mean = 0;
+	double m2 = 0;
+	for (int i = 0; i < n; i++) {
+		double delta = values[i]-mean;
+		mean += delta/(i+1);
+		m2 += delta*(values[i]-mean);
+	}
+	s.mean = mean;
+	if (n > 1) {
+		s.sd = sqrt(m2/(n-1));
+	}
+	//shortest interval holding level of the samples
+	std::sort(values.begin(), values.end());
+	int m = ceil(level*n);
+	if (m < 1) {
+		m = 1;
+	} else if (m > n) {
+		m = n;
+	}
+	int best = 0;
+	for (int i = 1; i + m - 1 < n; i++) {
+		if (values[i+m-1]-values[i] < values[best+m-1]-values[best]) {
+			best = i;
+		}
+	}
+	s.hpd_lower = values[best];
+	s.hpd_upper = values[best+m-1];
+	return s;
+}
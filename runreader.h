@@ -0,0 +1,95 @@
+/*
+ *  runreader.h
+ *  Selection_Recombination
+ *
+ */
+
+#pragma once
+
+#ifndef runreader_H
+#define runreader_H
+
+#include "gzstream.h"
+#include "trajfile.h"
+#include <string>
+#include <vector>
+
+//Readers for the output of an MCMC run, for post-processing without going through R.
+//next() returns false at the end of the file, and also on a line it can't read; bad() tells the
+//two apart, and get_error() says which line it was. A last line without a newline is one the run
+//was stopped partway through writing, and counts as the end of the file.
+
+//output_prefix.param.gz: a header line, then gen and one number per column on each line
+class param_reader {
+public:
+	bool open(std::string fileName, int bufferSize = 1 << 20);
+	std::vector<std::string>& get_columns() {return columns;}; //names of the columns after gen
+	int find_column(std::string name); //index into get_columns(), -1 if there isn't one
+	bool next(int& gen, std::vector<double>& values);
+	bool bad() {return error != "";};
+	std::string get_error() {return error;};
+
+private:
+	igzstream in;
+	std::string name;
+	std::string line;
+	int line_num;
+	std::vector<std::string> columns;
+	std::string error;
+};
+
+//the sampled trajectories, as frequencies, from output_prefix.traj.bin if there is one and
+//otherwise from output_prefix.traj.gz and output_prefix.time.gz. Lines of the .time file with
+//only the generation are filled in with the grid from the line before.
+class run_traj_reader {
+public:
+	run_traj_reader() {binary = false; have_time = false; num_read = 0;};
+
+	bool open(std::string baseName, int bufferSize = 1 << 20);
+	bool is_binary() {return binary;};
+	bool next(int& gen, std::vector<double>& freq, std::vector<double>& time);
+	bool bad() {return error != "";};
+	std::string get_error() {return error;};
+
+private:
+	bool binary;
+	traj_reader bin;
+	igzstream trajFile;
+	igzstream timeFile;
+	std::string name;
+	std::string trajLine;
+	std::string timeLine;
+	std::vector<double> last_time;
+	bool have_time;
+	int num_read; //records or lines so far
+	std::string error;
+
+	bool fail(std::string file, std::string why);
+};
+
+//which samples to use: none from before generation burnin, then every thin-th one
+class sample_filter {
+public:
+	sample_filter(int b = 0, int t = 1) {burnin = b; thin = (t < 1) ? 1 : t; seen = 0;};
+	bool keep(int gen) {return gen >= burnin && (seen++ % thin) == 0;};
+
+private:
+	int burnin;
+	int thin;
+	int seen; //samples after the burn-in so far
+};
+
+//posterior mean, standard deviation and highest posterior density interval of one column
+struct column_summary {
+	double mean;
+	double sd;
+	double hpd_lower;
+	double hpd_upper;
+};
+column_summary summarize_column(std::vector<double>& values, double level); //sorts values
+
+//reads the numbers on line after the first into values, and the first into gen; false if
+//there's nothing on the line or something that isn't a number
+bool parse_line(const std::string& line, int& gen, std::vector<double>& values);
+
+#endif
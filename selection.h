@@ -0,0 +1,43 @@
+/*
+ *  selection.h
+ *  Selection_Recombination
+ *
+ *  Everything needed to run the sampler from another program, linking against libselection
+ *  (the libselection target of CMakeLists.txt). A chain is set up from a settings object, the
+ *  same one sr builds from its command line:
+ *
+ *      settings s(argc, argv);
+ *      MbRandom r(s.get_seed());
+ *      popsize pop(s); //or s.parse_popsize_file()
+ *      for (each locus) {
+ *          std::vector<sample_time*> samples = ...; //or s.parse_input_file(&r)
+ *          mcmc chain(s, &r, new popsize(pop), samples);
+ *          my_sink out; //an mcmc_sink, or a file_sink to write what sr writes
+ *          chain.add_sink(&out);
+ *          chain.step(1000); //and look at chain.get_lnL(), chain.get_par(i)->get(), ...
+ *          chain.run(); //the rest of the -n generations
+ *      }
+ *
+ *  The chain owns the population size history and the samples it is given, and deletes them.
+ *
+ */
+
+#pragma once
+
+#ifndef selection_H
+#define selection_H
+
+#include "MbRandom.h"
+#include "settings.h"
+#include "popsize.h"
+#include "path.h"
+#include "param.h"
+#include "measure.h"
+#include "output.h"
+#include "mcmc.h"
+#include "bridges.h"
+#include "simulate.h"
+#include "surface.h"
+#include "reweight.h"
+
+#endif
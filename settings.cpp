@@ -19,12 +19,14 @@
 #include <sstream>
 #include <iostream>
 #include <algorithm>
+#include <thread>
 
 settings::settings(int argc, char* const argv[]) {
 	
 	//define defaults
 	max_dt = 0.001;
 	min_grid = 10;
+	grid_adapt = 0;
 	bridge = 0;
 	mcmc = 0;
 	linked_sites = 0;
@@ -60,6 +62,26 @@ settings::settings(int argc, char* const argv[]) {
     fix_h = false;
     min_freq = 0;
     ascertain = false;
+    gz_level = -1;
+    gz_buffer = 1;
+    gz_threads = 1;
+    binary_bits = 0;
+    summary_pars = "";
+    write_traj = true;
+    num_bridges = 0;
+    sim_pars = "";
+    surface_pars = "";
+    surface_input = "";
+    alpha_prior = 10.0;
+    new_alpha_prior = 0;
+    reweight_pop = "";
+    burnin = 0;
+    init_from = "";
+    path_error = false;
+    num_threads = std::thread::hardware_concurrency();
+    if (num_threads < 1) {
+        num_threads = 1;
+    }
 
 	//read the parameters
 	int ac = 1;
@@ -73,6 +95,14 @@ settings::settings(int argc, char* const argv[]) {
 				min_grid = atoi(argv[ac+1]);
 				ac += 2;
 				break;
+			case 'x':
+				grid_adapt = atof(argv[ac+1]);
+				if (grid_adapt < 0) {
+					std::cerr << "ERROR: The spacing factor of the adaptive time grid can't be negative" << std::endl;
+					exit(1);
+				}
+				ac += 2;
+				break;
 			case 'n':
 				num_gen = atoi(argv[ac+1]);
 				ac += 2;
@@ -168,10 +198,117 @@ settings::settings(int argc, char* const argv[]) {
                 min_freq = atof(argv[ac+1]);
                 ac += 2;
                 break;
+            case 'Z':
+                gz_level = atoi(argv[ac+1]);
+                if (gz_level < 0 || gz_level > 9) {
+                    std::cerr << "ERROR: compression level must be between 0 and 9" << std::endl;
+                    exit(1);
+                }
+                ac += 2;
+                break;
+            case 'z':
+                gz_buffer = atof(argv[ac+1]);
+                ac += 2;
+                break;
+            case 'j':
+                gz_threads = atoi(argv[ac+1]);
+                ac += 2;
+                break;
+            case 'W':
+                binary_bits = atoi(argv[ac+1]);
+                if (binary_bits != 32 && binary_bits != 64) {
+                    std::cerr << "ERROR: binary trajectories must have 32 or 64 bit floats" << std::endl;
+                    exit(1);
+                }
+                ac += 2;
+                break;
+            case 'q':
+                summary_pars = argv[ac+1];
+                parse_summary_pars();
+                ac += 2;
+                break;
+            case 'Q':
+                write_traj = false;
+                ac += 1;
+                break;
+            case 'B':
+                num_bridges = atoi(argv[ac+1]);
+                if (num_bridges < 1) {
+                    std::cerr << "ERROR: -B needs a positive number of bridges" << std::endl;
+                    exit(1);
+                }
+                ac += 2;
+                break;
+            case 'J':
+                num_threads = atoi(argv[ac+1]);
+                if (num_threads < 1) {
+                    std::cerr << "ERROR: -J needs at least one thread" << std::endl;
+                    exit(1);
+                }
+                ac += 2;
+                break;
+            case 'S':
+                sim_pars = argv[ac+1];
+                parse_sim_pars();
+                ac += 2;
+                break;
+            case 'L':
+                surface_pars = argv[ac+1];
+                parse_surface_pars();
+                ac += 2;
+                break;
+            case 'I':
+                surface_input = argv[ac+1];
+                ac += 2;
+                break;
+            case 'c':
+                alpha_prior = atof(argv[ac+1]);
+                if (alpha_prior <= 0) {
+                    std::cerr << "ERROR: The scale of the prior on alpha1 and alpha2 must be positive" << std::endl;
+                    exit(1);
+                }
+                ac += 2;
+                break;
+            case 'C':
+                new_alpha_prior = atof(argv[ac+1]);
+                if (new_alpha_prior <= 0) {
+                    std::cerr << "ERROR: The scale of the prior on alpha1 and alpha2 must be positive" << std::endl;
+                    exit(1);
+                }
+                ac += 2;
+                break;
+            case 'V':
+                reweight_pop = argv[ac+1];
+                ac += 2;
+                break;
+            case 'u':
+                burnin = atoi(argv[ac+1]);
+                ac += 2;
+                break;
+            case 'i':
+                init_from = argv[ac+1];
+                ac += 2;
+                break;
+            case 'Y':
+                path_error = true;
+                ac += 1;
+                break;
 		}
 	}
 }
 
+std::string settings::get_init_from() {
+    return init_from.substr(0, init_from.rfind(','));
+}
+
+int settings::get_init_gen() {
+    size_t comma = init_from.rfind(',');
+    if (comma == std::string::npos) {
+        return -1;
+    }
+    return atoi(init_from.substr(comma+1).c_str());
+}
+
 std::vector<double> settings::parse_bridge_pars() {
 	std::vector<double> pars(0);
 	std::string string_pars(bridge_pars);
@@ -189,6 +326,72 @@ std::vector<double> settings::parse_bridge_pars() {
 	return pars;
 }
 
+std::vector<double> settings::parse_summary_pars() {
+	std::vector<double> pars(0);
+	std::istringstream stringstream_pars(summary_pars);
+	std::string cur_par;
+	
+	while (std::getline(stringstream_pars,cur_par,',')) {
+		pars.push_back(atof(cur_par.c_str()));
+	}
+	if (pars.size() < 3 || pars.size() > 4) {
+		std::cerr << "ERROR: The summary grid needs start,end,points and optionally a burn-in" << std::endl;
+		exit(1);
+	}
+	if (pars.size() == 3) {
+		pars.push_back(0);
+	}
+	return pars;
+}
+
+std::vector<double> settings::parse_sim_pars() {
+	std::vector<double> pars(0);
+	std::istringstream stringstream_pars(sim_pars);
+	std::string cur_par;
+	
+	while (std::getline(stringstream_pars,cur_par,',')) {
+		pars.push_back(atof(cur_par.c_str()));
+	}
+	if (pars.size() < 4 || pars.size() > 5) {
+		std::cerr << "ERROR: Simulating needs alpha1,alpha2,age,replicates and optionally an overdispersion F" << std::endl;
+		exit(1);
+	}
+	if (pars[3] < 1) {
+		std::cerr << "ERROR: -S needs a positive number of replicates" << std::endl;
+		exit(1);
+	}
+	if (pars.size() == 4) {
+		pars.push_back(0);
+	}
+	if (pars[4] < 0 || pars[4] >= 1) {
+		std::cerr << "ERROR: The overdispersion F must be at least 0 and less than 1" << std::endl;
+		exit(1);
+	}
+	return pars;
+}
+
+std::vector<double> settings::parse_surface_pars() {
+	std::vector<double> pars(0);
+	std::istringstream stringstream_pars(surface_pars);
+	std::string cur_par;
+	
+	while (std::getline(stringstream_pars,cur_par,',')) {
+		pars.push_back(atof(cur_par.c_str()));
+	}
+	if (pars.size() < 6 || pars.size() > 7) {
+		std::cerr << "ERROR: The likelihood surface grid needs alpha1 start,end,points, alpha2 start,end,points and optionally a burn-in" << std::endl;
+		exit(1);
+	}
+	if (pars[2] < 1 || pars[5] < 1) {
+		std::cerr << "ERROR: The likelihood surface grid needs at least one point for each of alpha1 and alpha2" << std::endl;
+		exit(1);
+	}
+	if (pars.size() == 6) {
+		pars.push_back(0);
+	}
+	return pars;
+}
+
 void settings::print() {
 	std::cout << "max_dt\t" << max_dt << std::endl;
 	std::cout << "min_grid\t" << min_grid << std::endl;
@@ -30,6 +30,7 @@ public:
 	//get stuff
 	double get_dt() {return max_dt;};
 	int get_grid() {return min_grid;};
+	double get_grid_adapt() {return grid_adapt;};
 	bool get_bridge() {return bridge;};
 	bool get_mcmc() {return mcmc;};
 	bool get_linked() {return linked_sites;};
@@ -65,15 +66,38 @@ public:
     bool get_fix_h() {return fix_h;};
     bool get_ascertain() {return ascertain;};
     double get_min_freq() {return min_freq;};
+    int get_gz_level() {return gz_level;};
+    int get_gz_buffer() {return int(gz_buffer*1024*1024);}; //in bytes
+    int get_gz_threads() {return gz_threads;};
+    int get_binary_bits() {return binary_bits;};
+    bool get_summary() {return summary_pars != "";};
+    bool get_write_traj() {return write_traj;};
+    int get_num_bridges() {return num_bridges;};
+    int get_num_threads() {return num_threads;};
+    bool get_simulate() {return sim_pars != "";};
+    bool get_surface() {return surface_pars != "";};
+    std::string get_surface_input() {return surface_input;};
+    double get_alpha_prior() {return alpha_prior;};
+    double get_new_alpha_prior() {return new_alpha_prior > 0 ? new_alpha_prior : alpha_prior;};
+    bool get_reweight() {return reweight_pop != "";};
+    std::string get_reweight_pop() {return reweight_pop;};
+    int get_burnin() {return burnin;};
+    std::string get_init_from(); //with -i, the output prefix of the run to start from
+    int get_init_gen(); //and the generation of it to start from, -1 for its last sample
+    bool get_path_error() {return path_error;};
 		
 	//parse things
 	std::vector<double> parse_bridge_pars();
+    std::vector<double> parse_summary_pars();
+    std::vector<double> parse_sim_pars();
+    std::vector<double> parse_surface_pars();
     std::vector<sample_time*> parse_input_file(MbRandom* r);
     popsize* parse_popsize_file();
 	
 private:
 	double max_dt; //largest acceptable dt for paths
 	int min_grid; //smallest acceptable number of grid points between the start and end of a path
+	double grid_adapt; //with -x, make the grid finer near a path's ends at 0 or 1, with spacing this times x^2 there
 	int num_gen; //number of mcmc cyles to run
 	bool mcmc; //do mcmc?
 	bool linked_sites; //incorproate linked sites?
@@ -110,6 +134,23 @@ private:
     bool fix_h;
     double min_freq;
     bool ascertain;
+    int gz_level; //compression level of the output files, -1 for zlib's default
+    double gz_buffer; //size of the output buffers, in MB
+    int gz_threads; //number of threads compressing each output file
+    int binary_bits; //if nonzero, write trajectories to .traj.bin with floats of this many bits
+    std::string summary_pars; //grid for the trajectory summary: start,end,points[,burnin]
+    bool write_traj; //write the sampled trajectories at all?
+    int num_bridges; //with -b, how many bridges to make on worker threads; 0 for the single one
+    int num_threads; //worker threads for -B and -S
+    std::string sim_pars; //data sets to simulate: alpha1,alpha2,age,replicates[,F]
+    std::string surface_pars; //likelihood surface grid: alpha1 start,end,points,alpha2 start,end,points[,burnin]
+    std::string surface_input; //output prefix of the run to compute the surface from, "" for this run
+    double alpha_prior; //scale of the Cauchy prior on alpha1 and alpha2
+    double new_alpha_prior; //with -V, the scale to reweight to; 0 for the same as alpha_prior
+    std::string reweight_pop; //with -V, the population size history the run to reweight used
+    int burnin; //with -V, ignore samples from before this generation
+    std::string init_from; //the run to start from: prefix or prefix,gen; "" for a fresh start
+    bool path_error; //with -Y, compare the path likelihood with the one on a grid twice as coarse
 };
 
 
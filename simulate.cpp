@@ -0,0 +1,220 @@
+/*
+ *  simulate.cpp
+ *  Selection_Recombination
+ *
+ */
+
+#include "simulate.h"
+#include "MbRandom.h"
+#include "blocks.h"
+#include "param.h"
+#include "popsize.h"
+#include "settings.h"
+#include "textbuf.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <stdlib.h>
+#include "math.h"
+
+//attempts at a replicate before giving up, if the allele is nearly always lost
+static const long max_tries = 1000000;
+
+//what every replicate shares, in units of 2N0 generations
+struct sim_design {
+	std::vector<double> oldest; //range of each sample time
+	std::vector<double> youngest;
+	std::vector<int> ss; //sample sizes
+	double age;
+	double x0; //frequency at the age
+	double alpha1;
+	double alpha2;
+	double F; //overdispersion, 0 for binomial samples
+	double dt; //largest time step
+	popsize* rho;
+};
+
+//one replicate, made by a worker thread
+struct sim_replicate {
+	std::vector<int> counts;
+	std::vector<double> freq;
+	long tries;
+};
+
+//Euler-Maruyama steps of at most dt from t0 to t, starting at frequency p. This is the diffusion
+//the likelihoods in measure.cpp are for, in frequency rather than angular coordinates: the drift
+//is 1/2 p(1-p)(alpha2+(2alpha1-alpha2)(1-2p)) and the variance p(1-p)/N(t). 0 and 1 absorb.
+static double advance(double p, double t0, double t, sim_design& d, MbRandom& r) {
+	int steps = ceil((t-t0)/d.dt);
+	if (steps < 1) {
+		return p;
+	}
+	double h = (t-t0)/steps;
+	double sqrt_h = sqrt(h);
+	for (int i = 0; i < steps && p > 0 && p < 1; i++) {
+		double N = d.rho->getSize(t0+i*h);
+		double drift = p*(1-p)/2.0*(d.alpha2+(2*d.alpha1-d.alpha2)*(1-2*p));
+		p += drift*h + sqrt(p*(1-p)/N)*sqrt_h*r.normalRv(0, 1);
+		if (p < 0) {
+			p = 0;
+		} else if (p > 1) {
+			p = 1;
+		}
+	}
+	return p;
+}
+
+//one replicate that is still segregating at the last sample; returns the number of attempts
+static long simulate_one(sim_design& d, MbRandom& r, std::vector<int>& counts, std::vector<double>& freq) {
+	int n = d.ss.size();
+	std::vector<double> t(n);
+	std::vector<int> order(n);
+	counts.resize(n);
+	freq.resize(n);
+	for (long tries = 1; tries <= max_tries; tries++) {
+		for (int i = 0; i < n; i++) {
+			t[i] = d.oldest[i] < d.youngest[i] ? r.uniformRv(d.oldest[i], d.youngest[i]) : d.oldest[i];
+			order[i] = i;
+		}
+		std::sort(order.begin(), order.end(), [&](int a, int b) {return t[a] < t[b];});
+		double p = d.x0;
+		double cur = d.age;
+		for (int k = 0; k < n; k++) {
+			int i = order[k];
+			if (t[i] < d.age) {
+				//before the allele arose
+				freq[i] = 0;
+				continue;
+			}
+			p = advance(p, cur, t[i], d, r);
+			cur = t[i];
+			freq[i] = p;
+		}
+		if (p == 0 || p == 1) {
+			continue;
+		}
+		for (int i = 0; i < n; i++) {
+			double q = freq[i];
+			if (d.F > 0 && q > 0 && q < 1) {
+				q = r.betaRv((1-d.F)/d.F*q, (1-d.F)/d.F*(1-q));
+			}
+			counts[i] = 0;
+			for (int j = 0; j < d.ss[i]; j++) {
+				if (r.uniformRv() < q) {
+					counts[i]++;
+				}
+			}
+		}
+		return tries;
+	}
+	std::cerr << "ERROR: The allele was lost or fixed by the last sample in " << max_tries << " simulations in a row" << std::endl;
+	exit(1);
+}
+
+void simulate_data(settings& s, MbRandom* r) {
+	std::vector<double> pars = s.parse_sim_pars();
+	int num_reps = pars[3];
+	int num_threads = s.get_num_threads();
+	if (s.get_infile() == "") {
+		std::cerr << "ERROR: -S needs the sample times and sizes, in a -D file" << std::endl;
+		exit(1);
+	}
+
+	//the design, in units of 2N0 generations
+	double time_units = s.get_gen_time()*2*s.get_N0();
+	sim_design d;
+	d.rho = s.parse_popsize_file();
+	std::vector<sample_time*> samples = s.parse_input_file(r);
+	for (int i = 0; i < samples.size(); i++) {
+		d.oldest.push_back(samples[i]->get_oldest());
+		d.youngest.push_back(samples[i]->get_youngest());
+		d.ss.push_back(samples[i]->get_ss());
+		delete samples[i];
+	}
+	d.age = pars[2]/time_units;
+	d.alpha1 = pars[0];
+	d.alpha2 = pars[1];
+	d.F = pars[4];
+	d.dt = s.get_dt();
+	if (d.age >= d.youngest.back()) {
+		std::cerr << "ERROR: The age must be before the most recent sample" << std::endl;
+		exit(1);
+	}
+	if (s.get_fOrigin() > 0) {
+		d.x0 = s.get_fOrigin();
+	} else if (s.get_set_N0()) {
+		d.x0 = 1.0/(2*s.get_N0()*d.rho->getSize(d.age));
+	} else {
+		std::cerr << "ERROR: -S needs the frequency the allele starts at, -O, or a reference population size, -N" << std::endl;
+		exit(1);
+	}
+	if (d.x0 <= 0 || d.x0 >= 1) {
+		std::cerr << "ERROR: The allele has to start at a frequency between 0 and 1, not " << d.x0 << std::endl;
+		exit(1);
+	}
+	std::cerr << "Simulating " << num_reps << " data sets with (alpha1, alpha2, age) = (" << pars[0] << ", " << pars[1]
+	    << ", " << pars[2] << ") from frequency " << d.x0 << " on " << num_threads << " threads" << std::endl;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::string simName = s.get_baseName() + ".sim";
+	std::ofstream simFile(simName.c_str());
+	if (!simFile) {
+		std::cerr << "ERROR: could not open " << simName << std::endl;
+		exit(1);
+	}
+	simFile << "replicate\ttries";
+	for (int i = 0; i < d.ss.size(); i++) {
+		simFile << "\tfreq_" << i;
+	}
+	simFile << std::endl;
+	text_buffer line;
+
+	long tries = 0;
+	for_each_item_block<sim_replicate>(num_reps, num_threads, s.get_seed(),
+		[&](MbRandom& r, int first, std::vector<sim_replicate>& reps) {
+			for (int i = 0; i < reps.size(); i++) {
+				reps[i].tries = simulate_one(d, r, reps[i].counts, reps[i].freq);
+			}
+		},
+		[&](int rep, sim_replicate& sim) {
+			std::ostringstream dataName;
+			dataName << s.get_baseName() << "_" << rep << ".txt";
+			std::ofstream dataFile(dataName.str().c_str());
+			if (!dataFile) {
+				std::cerr << "ERROR: could not open " << dataName.str() << std::endl;
+				exit(1);
+			}
+			for (int k = 0; k < d.ss.size(); k++) {
+				line.clear();
+				line.add(sim.counts[k]);
+				line.add('\t');
+				line.add(d.ss[k]);
+				line.add('\t');
+				line.add(d.oldest[k]*time_units, 10);
+				line.add('\t');
+				line.add(d.youngest[k]*time_units, 10);
+				line.add('\n');
+				line.write_to(dataFile);
+			}
+			line.clear();
+			line.add(rep);
+			line.add('\t');
+			line.add(int(sim.tries));
+			for (int k = 0; k < d.ss.size(); k++) {
+				line.add('\t');
+				line.add(sim.freq[k]);
+			}
+			line.add('\n');
+			line.write_to(simFile);
+			tries += sim.tries;
+		});
+	simFile.close();
+	delete d.rho;
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+	std::cerr << "Simulated " << num_reps << " data sets in " << seconds << " seconds (" << num_reps/seconds << " per second)" << std::endl;
+	std::cerr << "Made " << tries << " trajectories, " << double(num_reps)/tries << " of them still segregating at the last sample" << std::endl;
+}
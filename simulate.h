@@ -0,0 +1,26 @@
+/*
+ *  simulate.h
+ *  Selection_Recombination
+ *
+ */
+
+#pragma once
+
+#ifndef simulate_H
+#define simulate_H
+
+class settings;
+class MbRandom;
+
+//-S alpha1,alpha2,age,replicates[,F]: simulate data sets like the -D file, under the -P population
+//size history, on -J threads. Each replicate is a Wright-Fisher diffusion from the frequency -O
+//(1/2N at the age if -O isn't given and -N is) at the age, in the units of the -D file, up to the
+//most recent sample. Replicates where the allele is lost or fixed by then are thrown away and
+//made again. At each sample time (drawn uniformly from its range) the derived alleles are
+//counted in a sample of the same size as in the -D file, binomially, or beta-binomially with
+//overdispersion F. Replicate i goes to output_prefix_i.txt, in the -D format, and the
+//population frequencies at the samples to output_prefix.sim. As with -B, every block of
+//replicates has its own random number stream, so they don't depend on the number of threads.
+void simulate_data(settings& s, MbRandom* r);
+
+#endif
@@ -0,0 +1,180 @@
+/*
+ *  summary.cpp
+ *  Selection_Recombination
+ *
+ */
+
+#include "summary.h"
+#include <iostream>
+#include <fstream>
+#include <stdlib.h>
+#include "math.h"
+
+//same probabilities that plot.posterior.paths uses
+const double path_summary::probs[path_summary::num_probs] = {0.05, 0.25, 0.5, 0.75, 0.95};
+
+p2_quantile::p2_quantile(double prob) {
+	p = prob;
+	count = 0;
+	for (int i = 0; i < 5; i++) {
+		q[i] = 0;
+		n[i] = i;
+	}
+	np[0] = 0;
+	np[1] = 2*p;
+	np[2] = 4*p;
+	np[3] = 2+2*p;
+	np[4] = 4;
+	dn[0] = 0;
+	dn[1] = p/2;
+	dn[2] = p;
+	dn[3] = (1+p)/2;
+	dn[4] = 1;
+}
+
+void p2_quantile::add(double x) {
+	if (count < 5) {
+		//keep the first five sorted, they become the markers
+		int i = count;
+		while (i > 0 && q[i-1] > x) {
+			q[i] = q[i-1];
+			i--;
+		}
+		q[i] = x;
+		count++;
+		return;
+	}
+	count++;
+
+	//find the cell x falls in, moving the extreme markers if it's outside them
+	int k;
+	if (x < q[0]) {
+		q[0] = x;
+		k = 0;
+	} else if (x >= q[4]) {
+		q[4] = x;
+		k = 3;
+	} else {
+		k = 0;
+		while (x >= q[k+1]) {
+			k++;
+		}
+	}
+	for (int i = k+1; i < 5; i++) {
+		n[i]++;
+	}
+	for (int i = 0; i < 5; i++) {
+		np[i] += dn[i];
+	}
+
+	//move the middle markers towards where they should be
+	for (int i = 1; i < 4; i++) {
+		double d = np[i]-n[i];
+		if ((d >= 1 && n[i+1]-n[i] > 1) || (d <= -1 && n[i-1]-n[i] < -1)) {
+			d = (d > 0) ? 1 : -1;
+			double qp = parabolic(i, d);
+			if (q[i-1] < qp && qp < q[i+1]) {
+				q[i] = qp;
+			} else {
+				q[i] = linear(i, d);
+			}
+			n[i] += d;
+		}
+	}
+}
+
+double p2_quantile::parabolic(int i, double d) {
+	return q[i] + d/(n[i+1]-n[i-1])*((n[i]-n[i-1]+d)*(q[i+1]-q[i])/(n[i+1]-n[i]) + (n[i+1]-n[i]-d)*(q[i]-q[i-1])/(n[i]-n[i-1]));
+}
+
+double p2_quantile::linear(int i, double d) {
+	int j = i + (int)d;
+	return q[i] + d*(q[j]-q[i])/(n[j]-n[i]);
+}
+
+double p2_quantile::get() {
+	if (count == 0) {
+		return NAN;
+	}
+	if (count <= 5) {
+		//exact, interpolating between order statistics like R's quantile()
+		double h = (count-1)*p;
+		int lo = floor(h);
+		if (lo >= count-1) {
+			return q[count-1];
+		}
+		return q[lo] + (h-lo)*(q[lo+1]-q[lo]);
+	}
+	return q[2];
+}
+
+path_summary::path_summary(double start, double end, int points) {
+	if (points < 1 || (points > 1 && end <= start)) {
+		std::cerr << "ERROR: summary grid needs at least one point and start before end" << std::endl;
+		exit(1);
+	}
+	grid.resize(points);
+	for (int i = 0; i < points; i++) {
+		grid[i] = (points == 1) ? start : start + i*(end-start)/(points-1);
+	}
+	count = 0;
+	mean.resize(points, 0);
+	m2.resize(points, 0);
+	for (int i = 0; i < points; i++) {
+		for (int j = 0; j < num_probs; j++) {
+			quantiles.push_back(p2_quantile(probs[j]));
+		}
+	}
+}
+
+void path_summary::add(const std::vector<double>& freq, const std::vector<double>& time) {
+	count++;
+	int j = 0;
+	for (int i = 0; i < grid.size(); i++) {
+		double f;
+		if (time.size() == 0 || grid[i] < time[0]) {
+			//before the path starts the allele isn't there yet
+			f = 0;
+		} else if (grid[i] >= time.back()) {
+			f = freq.back();
+		} else {
+			//both are increasing, so carry on from the last interval
+			while (time[j+1] <= grid[i]) {
+				j++;
+			}
+			double w = (grid[i]-time[j])/(time[j+1]-time[j]);
+			f = freq[j] + w*(freq[j+1]-freq[j]);
+		}
+		double delta = f-mean[i];
+		mean[i] += delta/count;
+		m2[i] += delta*(f-mean[i]);
+		for (int k = 0; k < num_probs; k++) {
+			quantiles[i*num_probs+k].add(f);
+		}
+	}
+}
+
+void path_summary::write(std::string fileName) {
+	std::ofstream out(fileName.c_str());
+	if (!out.good()) {
+		std::cerr << "ERROR: could not open " << fileName << std::endl;
+		exit(1);
+	}
+	out << "time\tmean\tsd";
+	for (int k = 0; k < num_probs; k++) {
+		out << "\tq" << probs[k];
+	}
+	out << "\n";
+	for (int i = 0; i < grid.size(); i++) {
+		out << grid[i] << "\t" << ((count > 0) ? mean[i] : NAN) << "\t" << ((count > 1) ? sqrt(m2[i]/(count-1)) : NAN);
+		for (int k = 0; k < num_probs; k++) {
+			out << "\t" << quantiles[i*num_probs+k].get();
+		}
+		out << "\n";
+	}
+	out.close();
+	if (out.fail()) {
+		std::cerr << "ERROR: could not write " << fileName << std::endl;
+		exit(1);
+	}
+}
@@ -0,0 +1,58 @@
+/*
+ *  summary.h
+ *  Selection_Recombination
+ *
+ */
+
+#pragma once
+
+#ifndef summary_H
+#define summary_H
+
+#include <vector>
+#include <string>
+
+//Streaming estimate of one quantile with the P^2 algorithm (Jain and Chlamtac 1985). Keeps
+//five markers instead of the observations; exact until there are five of them.
+class p2_quantile {
+public:
+	p2_quantile(double prob);
+
+	void add(double x);
+	double get();
+
+private:
+	double p;
+	int count;
+	double q[5]; //marker heights
+	double n[5]; //marker positions
+	double np[5]; //desired marker positions
+	double dn[5]; //increments of the desired positions
+
+	double parabolic(int i, double d);
+	double linear(int i, double d);
+};
+
+//Posterior summary of the sampled trajectories on a fixed time grid. Every path added is
+//interpolated onto the grid, and each grid point keeps a running mean and variance (Welford)
+//and P^2 estimates of the quantiles in probs, so nothing has to be kept per sample.
+class path_summary {
+public:
+	path_summary(double start, double end, int points); //points evenly spaced from start to end, in units of 2N generations
+
+	void add(const std::vector<double>& freq, const std::vector<double>& time); //freq[i] is the frequency at time[i], times increasing
+	int get_count() {return count;};
+	void write(std::string fileName); //one line per grid point: time, mean, sd and the quantiles
+
+	static const int num_probs = 5;
+	static const double probs[num_probs];
+
+private:
+	std::vector<double> grid;
+	int count;
+	std::vector<double> mean;
+	std::vector<double> m2; //sum of squared deviations from the mean
+	std::vector<p2_quantile> quantiles; //num_probs per grid point
+};
+
+#endif
@@ -0,0 +1,208 @@
+/*
+ *  surface.cpp
+ *  Selection_Recombination
+ *
+ */
+
+#include "surface.h"
+#include "path.h"
+#include "popsize.h"
+#include "runpaths.h"
+#include "settings.h"
+#include "textbuf.h"
+
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <stdlib.h>
+#include "math.h"
+
+likelihood_surface::likelihood_surface(std::vector<double> pars) {
+	int n1 = pars[2];
+	int n2 = pars[5];
+	for (int i = 0; i < n1; i++) {
+		alpha1.push_back(n1 == 1 ? pars[0] : pars[0]+(pars[1]-pars[0])*i/(n1-1));
+	}
+	for (int i = 0; i < n2; i++) {
+		alpha2.push_back(n2 == 1 ? pars[3] : pars[3]+(pars[4]-pars[3])*i/(n2-1));
+	}
+}
+
+bool likelihood_surface::log_weight(path* p, popsize* rho, double alpha1, double alpha2, alpha_quadratic& w) {
+	cbp_wf_r_quadratic_integrand f;
+	girsanov_sums_t<alpha_quadratic> s;
+	bool legal;
+	if (rho->is_constant()) {
+		constant_demography d(rho);
+		legal = integrate_girsanov(p, f, d, s);
+	} else {
+		variable_demography d(rho);
+		legal = integrate_girsanov(p, f, d, s);
+	}
+	if (!legal) {
+		return false;
+	}
+	w = s.log_ratio();
+	//relative to the coefficients the path was sampled with, so the terms that don't depend on them cancel
+	w.c[0] -= w(alpha1, alpha2);
+	for (int k = 0; k < 6; k++) {
+		if (isnan(w.c[k]) || isinf(w.c[k])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void likelihood_surface::evaluate(int first, int last, std::vector<double>* lnL, std::vector<double>* ess) {
+	std::vector<double> lw(weights.size());
+	for (int g = first; g < last; g++) {
+		double a1 = alpha1[g/alpha2.size()];
+		double a2 = alpha2[g%alpha2.size()];
+		double max_lw = -INFINITY;
+		for (int i = 0; i < weights.size(); i++) {
+			lw[i] = weights[i](a1, a2);
+			if (lw[i] > max_lw) {
+				max_lw = lw[i];
+			}
+		}
+		double sum = 0;
+		double sum2 = 0;
+		for (int i = 0; i < weights.size(); i++) {
+			double v = exp(lw[i]-max_lw);
+			sum += v;
+			sum2 += v*v;
+		}
+		(*lnL)[g] = max_lw+log(sum/weights.size());
+		(*ess)[g] = sum*sum/sum2;
+	}
+}
+
+void likelihood_surface::write(std::string fileName, int num_threads) {
+	if (weights.size() == 0) {
+		std::cerr << "ERROR: No paths to compute the likelihood surface from" << std::endl;
+		exit(1);
+	}
+	int num_points = alpha1.size()*alpha2.size();
+	std::vector<double> lnL(num_points);
+	std::vector<double> ess(num_points);
+	std::vector<std::thread> workers;
+	for (int i = 0; i < num_threads; i++) {
+		int first = (long)num_points*i/num_threads;
+		int last = (long)num_points*(i+1)/num_threads;
+		if (first < last) {
+			workers.push_back(std::thread(&likelihood_surface::evaluate, this, first, last, &lnL, &ess));
+		}
+	}
+	for (int i = 0; i < workers.size(); i++) {
+		workers[i].join();
+	}
+	double max_lnL = -INFINITY;
+	for (int g = 0; g < num_points; g++) {
+		if (lnL[g] > max_lnL) {
+			max_lnL = lnL[g];
+		}
+	}
+
+	std::ofstream out(fileName.c_str());
+	if (!out) {
+		std::cerr << "ERROR: could not open " << fileName << std::endl;
+		exit(1);
+	}
+	out << "alpha1\talpha2\tlnL\tess" << std::endl;
+	text_buffer line;
+	for (int g = 0; g < num_points; g++) {
+		line.clear();
+		line.add(alpha1[g/alpha2.size()]);
+		line.add('\t');
+		line.add(alpha2[g%alpha2.size()]);
+		line.add('\t');
+		line.add(lnL[g]-max_lnL);
+		line.add('\t');
+		line.add(ess[g]);
+		line.add('\n');
+		line.write_to(out);
+	}
+}
+
+surface_sink::surface_sink(settings& s) : surface(s.parse_surface_pars()) {
+	fileName = s.get_baseName() + ".surface";
+	burnin = s.parse_surface_pars()[6];
+	num_threads = s.get_num_threads();
+	alpha1_col = alpha2_col = -1;
+	skipped = 0;
+	finished = false;
+}
+
+void surface_sink::start(const std::vector<std::string>& columns) {
+	for (int i = 0; i < columns.size(); i++) {
+		if (columns[i] == "alpha1") {
+			alpha1_col = i;
+		} else if (columns[i] == "alpha2") {
+			alpha2_col = i;
+		}
+	}
+}
+
+void surface_sink::sample(int gen, const std::vector<double>& values, wfSamplePath* p) {
+	if (gen < burnin) {
+		return;
+	}
+	alpha_quadratic w;
+	if (likelihood_surface::log_weight(p, p->get_pop(), values[alpha1_col], values[alpha2_col], w)) {
+		surface.add(w);
+	} else {
+		skipped++;
+	}
+}
+
+void surface_sink::finish() {
+	if (finished) {
+		return;
+	}
+	finished = true;
+	surface.write(fileName, num_threads);
+	std::cerr << "Likelihood surface from " << surface.get_num_paths() << " paths";
+	if (skipped > 0) {
+		std::cerr << " (and " << skipped << " out of bounds)";
+	}
+	std::cerr << " written to " << fileName << std::endl;
+}
+
+void surface_from_run(settings& s) {
+	std::vector<double> pars = s.parse_surface_pars();
+	std::string baseName = s.get_surface_input();
+	popsize* rho = s.parse_popsize_file();
+
+	param_reader params;
+	run_traj_reader trajs;
+	open_run(baseName, params, trajs);
+	int alpha1_col = params.find_column("alpha1");
+	int alpha2_col = params.find_column("alpha2");
+	if (alpha1_col < 0 || alpha2_col < 0) {
+		std::cerr << "ERROR: " << baseName << ".param.gz has no alpha1 and alpha2 columns" << std::endl;
+		exit(1);
+	}
+
+	likelihood_surface surface(pars);
+	int skipped = 0;
+	for_each_run_sample<alpha_quadratic>(params, trajs, pars[6], s.get_num_threads(),
+		[&](path* p, const std::vector<double>& values, alpha_quadratic& w) {
+			return likelihood_surface::log_weight(p, rho, values[alpha1_col], values[alpha2_col], w);
+		},
+		[&](int gen, const std::vector<double>& values, bool ok, alpha_quadratic& w) {
+			if (ok) {
+				surface.add(w);
+			} else {
+				skipped++;
+			}
+		});
+
+	std::string fileName = s.get_baseName() + ".surface";
+	surface.write(fileName, s.get_num_threads());
+	std::cerr << "Likelihood surface from " << surface.get_num_paths() << " paths of " << baseName;
+	if (skipped > 0) {
+		std::cerr << " (and " << skipped << " out of bounds)";
+	}
+	std::cerr << " written to " << fileName << std::endl;
+	delete rho;
+}
@@ -0,0 +1,78 @@
+/*
+ *  surface.h
+ *  Selection_Recombination
+ *
+ */
+
+#pragma once
+
+#ifndef surface_H
+#define surface_H
+
+#include "girsanov.h"
+#include "output.h"
+#include <string>
+#include <vector>
+
+class settings;
+class popsize;
+class path;
+class wfSamplePath;
+
+//An importance sampled likelihood surface for the selection coefficients, from the paths of a
+//chain. A path sampled along with (alpha1', alpha2') has weight
+//    exp(log_girsanov_wf_r(alpha1, alpha2) - log_girsanov_wf_r(alpha1', alpha2'))
+//at (alpha1, alpha2), and the average weight over the samples is the likelihood of the data at
+//(alpha1, alpha2), up to a constant (the probability of the data given the path doesn't depend
+//on them, and cancels). The exponent is a quadratic in alpha1 and alpha2, worked out in one pass
+//over the path, so the whole grid costs little more than one point.
+class likelihood_surface {
+public:
+	//pars are from settings::parse_surface_pars
+	likelihood_surface(std::vector<double> pars);
+
+	//the log weight of p, sampled with alpha1 and alpha2, as a function of the selection
+	//coefficients; false if the path isn't a possible one
+	static bool log_weight(path* p, popsize* rho, double alpha1, double alpha2, alpha_quadratic& w);
+
+	void add(const alpha_quadratic& w) {weights.push_back(w);};
+	int get_num_paths() {return weights.size();};
+
+	//a line per grid point, with alpha1, alpha2, the log likelihood (0 at the highest point)
+	//and the effective sample size of the weights. The grid is split between num_threads threads.
+	void write(std::string fileName, int num_threads);
+
+private:
+	std::vector<double> alpha1; //the grid
+	std::vector<double> alpha2;
+	std::vector<alpha_quadratic> weights; //one per path
+
+	void evaluate(int first, int last, std::vector<double>* lnL, std::vector<double>* ess);
+};
+
+//-L with -D: the surface from the samples of this chain, written to output_prefix.surface
+class surface_sink : public mcmc_sink {
+public:
+	surface_sink(settings& s);
+
+	void start(const std::vector<std::string>& columns);
+	void sample(int gen, const std::vector<double>& values, wfSamplePath* p);
+	void finish();
+
+private:
+	likelihood_surface surface;
+	std::string fileName;
+	int burnin;
+	int num_threads;
+	int alpha1_col;
+	int alpha2_col;
+	int skipped; //paths out of bounds
+	bool finished;
+};
+
+//-L with -I prefix: the surface from the samples of an earlier run with output prefix prefix, read
+//from its output files, with the weights worked out on -J threads. The -P, -N and -G have to be
+//the ones the run used.
+void surface_from_run(settings& s);
+
+#endif
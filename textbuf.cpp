@@ -0,0 +1,141 @@
+/*
+ *  textbuf.cpp
+ *  Selection_Recombination
+ *
+ */
+
+#include "textbuf.h"
+#include <stdio.h>
+#include "math.h"
+
+//powers of ten that doubles hold exactly
+static const double exact_pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+	1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+static const long long int_pow10[] = {1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL,
+	10000000LL, 100000000LL, 1000000000LL, 10000000000LL};
+
+static int printf_g(double v, int precision, char* out) {
+	int n = snprintf(out, 64, "%.*g", precision, v);
+	return (n < 64) ? n : 63;
+}
+
+int format_g(double v, int precision, char* out) {
+	if (precision == 0) {
+		precision = 1;
+	}
+	double a = fabs(v);
+	if (precision < 0 || precision > 9 || !(a > 0) || a == INFINITY) {
+		//zero, nan, inf and long precisions are rare enough to leave to printf
+		return printf_g(v, precision, out);
+	}
+
+	//find the exponent e with 10^(precision-1) <= a*10^(precision-1-e) < 10^precision.
+	//Multiplying or dividing by an exact power of ten rounds only once, so scaled is within
+	//half an ulp of the true value
+	int e2;
+	frexp(a, &e2);
+	int e = (int)floor((e2-1)*0.30102999566398120);
+	double scaled = 0;
+	for (int tries = 0; tries < 3; tries++) {
+		int s = precision-1-e;
+		if (s > 22 || s < -22) {
+			return printf_g(v, precision, out);
+		}
+		scaled = (s >= 0) ? a*exact_pow10[s] : a/exact_pow10[-s];
+		if (scaled >= int_pow10[precision]) {
+			e++;
+		} else if (scaled < int_pow10[precision-1]) {
+			e--;
+		} else {
+			break;
+		}
+	}
+	double r = floor(scaled);
+	double frac = scaled-r;
+	if (fabs(frac-0.5) < 1e-6 || scaled < int_pow10[precision-1] || scaled >= int_pow10[precision]) {
+		//too close to half way to know which way printf rounds
+		return printf_g(v, precision, out);
+	}
+	long long m = (long long)r + (frac > 0.5);
+	if (m == int_pow10[precision]) {
+		//rounded up to the next power of ten
+		m = int_pow10[precision-1];
+		e++;
+	}
+
+	char digits[16];
+	for (int i = precision-1; i >= 0; i--) {
+		digits[i] = '0' + m%10;
+		m /= 10;
+	}
+	//%g drops trailing zeros
+	int nd = precision;
+	while (nd > 1 && digits[nd-1] == '0') {
+		nd--;
+	}
+
+	int n = 0;
+	if (v < 0) {
+		out[n++] = '-';
+	}
+	if (e < -4 || e >= precision) {
+		out[n++] = digits[0];
+		if (nd > 1) {
+			out[n++] = '.';
+			for (int i = 1; i < nd; i++) {
+				out[n++] = digits[i];
+			}
+		}
+		out[n++] = 'e';
+		out[n++] = (e < 0) ? '-' : '+';
+		int ae = (e < 0) ? -e : e;
+		if (ae >= 100) {
+			out[n++] = '0' + ae/100;
+		}
+		out[n++] = '0' + (ae/10)%10;
+		out[n++] = '0' + ae%10;
+	} else if (e >= 0) {
+		for (int i = 0; i <= e; i++) {
+			out[n++] = digits[i];
+		}
+		if (nd > e+1) {
+			out[n++] = '.';
+			for (int i = e+1; i < nd; i++) {
+				out[n++] = digits[i];
+			}
+		}
+	} else {
+		out[n++] = '0';
+		out[n++] = '.';
+		for (int i = 0; i < -e-1; i++) {
+			out[n++] = '0';
+		}
+		for (int i = 0; i < nd; i++) {
+			out[n++] = digits[i];
+		}
+	}
+	return n;
+}
+
+void text_buffer::add(double v, int precision) {
+	reserve(64);
+	len += format_g(v, precision, &buf[len]);
+}
+
+void text_buffer::add(int v) {
+	reserve(16);
+	unsigned int u = v;
+	if (v < 0) {
+		buf[len++] = '-';
+		u = 0u-u;
+	}
+	char digits[16];
+	int nd = 0;
+	do {
+		digits[nd++] = '0' + u%10;
+		u /= 10;
+	} while (u > 0);
+	while (nd > 0) {
+		buf[len++] = digits[--nd];
+	}
+}
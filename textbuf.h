@@ -0,0 +1,40 @@
+/*
+ *  textbuf.h
+ *  Selection_Recombination
+ *
+ */
+
+#pragma once
+
+#ifndef textbuf_H
+#define textbuf_H
+
+#include <vector>
+#include <ostream>
+
+//Builds a line of output in a reusable char buffer, so it can be handed to a stream with one
+//write() instead of going through operator<< for every number. Numbers come out exactly as
+//operator<< writes them on a stream with default flags (printf's %g in the C locale).
+class text_buffer {
+public:
+	text_buffer() : buf(256) {len = 0;};
+
+	void clear() {len = 0;};
+	void add(double v, int precision = 6);
+	void add(int v);
+	void add(char c) {reserve(1); buf[len++] = c;};
+	const char* data() {return &buf[0];};
+	size_t size() {return len;};
+	void write_to(std::ostream& o) {o.write(&buf[0], len);};
+
+private:
+	std::vector<char> buf;
+	size_t len;
+
+	void reserve(size_t n) {if (len + n > buf.size()) buf.resize(2*(len+n));};
+};
+
+//writes v to out like printf("%.*g", precision, v) and returns the number of chars. out needs room for 64
+int format_g(double v, int precision, char* out);
+
+#endif
@@ -0,0 +1,191 @@
+/*
+ *  sr_read.cpp
+ *  Selection_Recombination
+ *
+ *  Posterior summaries from the output of an sr run: mean, standard deviation and HPD
+ *  interval of the columns of the .param.gz file, and optionally quantiles of the
+ *  trajectories on a fixed time grid
+ *
+ */
+
+#include "runreader.h"
+#include "summary.h"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <stdlib.h>
+
+static void usage() {
+	std::cerr << "usage: sr_read [options] output_prefix" << std::endl;
+	std::cerr << "-u burn-in: ignore samples from before this generation (default 0)" << std::endl;
+	std::cerr << "-k thin: use every k-th sample after the burn-in (default 1)" << std::endl;
+	std::cerr << "-c col1,col2,...: columns of the param file to summarize (default all)" << std::endl;
+	std::cerr << "-p level: probability in the HPD intervals (default 0.95)" << std::endl;
+	std::cerr << "-q start,end,points: also summarize the trajectories at these times" << std::endl;
+	std::cerr << "-t file: where to write the trajectory summary (default output_prefix.traj.summary)" << std::endl;
+}
+
+static std::vector<std::string> split(std::string s) {
+	std::vector<std::string> parts;
+	std::istringstream in(s);
+	std::string cur;
+	while (std::getline(in, cur, ',')) {
+		parts.push_back(cur);
+	}
+	return parts;
+}
+
+//reads the trajectories and feeds them to summary; runs on its own thread
+static void read_trajectories(std::string baseName, sample_filter filter, path_summary* summary, bool* ok) {
+	run_traj_reader in;
+	if (!in.open(baseName)) {
+		std::cerr << "ERROR: could not open the trajectories of " << baseName << std::endl;
+		*ok = false;
+		return;
+	}
+	int gen;
+	std::vector<double> freq;
+	std::vector<double> time;
+	while (in.next(gen, freq, time)) {
+		if (filter.keep(gen)) {
+			summary->add(freq, time);
+		}
+	}
+	if (in.bad()) {
+		std::cerr << "ERROR: " << in.get_error() << std::endl;
+		*ok = false;
+		return;
+	}
+	*ok = true;
+}
+
+int main(int argc, char* argv[]) {
+	int burnin = 0;
+	int thin = 1;
+	double level = 0.95;
+	std::string columnList = "";
+	std::string gridList = "";
+	std::string trajSummaryName = "";
+	std::string baseName = "";
+
+	int ac = 1;
+	while (ac < argc) {
+		if (argv[ac][0] != '-') {
+			baseName = argv[ac];
+			ac += 1;
+			continue;
+		}
+		if (ac+1 >= argc) {
+			usage();
+			return 1;
+		}
+		switch(argv[ac][1]) {
+			case 'u':
+				burnin = atoi(argv[ac+1]);
+				break;
+			case 'k':
+				thin = atoi(argv[ac+1]);
+				break;
+			case 'c':
+				columnList = argv[ac+1];
+				break;
+			case 'p':
+				level = atof(argv[ac+1]);
+				break;
+			case 'q':
+				gridList = argv[ac+1];
+				break;
+			case 't':
+				trajSummaryName = argv[ac+1];
+				break;
+			default:
+				usage();
+				return 1;
+		}
+		ac += 2;
+	}
+	if (baseName == "" || level <= 0 || level > 1) {
+		usage();
+		return 1;
+	}
+
+	param_reader params;
+	std::string paramName = baseName + ".param.gz";
+	if (!params.open(paramName)) {
+		std::cerr << "ERROR: could not read " << paramName << std::endl;
+		return 1;
+	}
+	std::vector<int> cols;
+	if (columnList == "") {
+		for (int i = 0; i < params.get_columns().size(); i++) {
+			cols.push_back(i);
+		}
+	} else {
+		std::vector<std::string> names = split(columnList);
+		for (int i = 0; i < names.size(); i++) {
+			int c = params.find_column(names[i]);
+			if (c < 0) {
+				std::cerr << "ERROR: " << paramName << " has no column " << names[i] << std::endl;
+				return 1;
+			}
+			cols.push_back(c);
+		}
+	}
+
+	//the trajectories are in other files, so they can be decompressed and parsed at the same time as the params
+	path_summary* summary = NULL;
+	std::thread trajThread;
+	bool trajOk = false;
+	if (gridList != "") {
+		std::vector<std::string> grid = split(gridList);
+		if (grid.size() != 3) {
+			std::cerr << "ERROR: The trajectory grid needs start,end,points" << std::endl;
+			return 1;
+		}
+		summary = new path_summary(atof(grid[0].c_str()), atof(grid[1].c_str()), atoi(grid[2].c_str()));
+		trajThread = std::thread(read_trajectories, baseName, sample_filter(burnin, thin), summary, &trajOk);
+	}
+
+	std::vector<std::vector<double> > samples(cols.size());
+	sample_filter filter(burnin, thin);
+	int gen;
+	std::vector<double> values;
+	while (params.next(gen, values)) {
+		if (filter.keep(gen)) {
+			for (int i = 0; i < cols.size(); i++) {
+				samples[i].push_back(values[cols[i]]);
+			}
+		}
+	}
+	if (params.bad()) {
+		std::cerr << "ERROR: " << params.get_error() << std::endl;
+		if (summary != NULL) {
+			trajThread.join();
+		}
+		return 1;
+	}
+
+	std::cout << "column\tmean\tsd\thpd_lower\thpd_upper" << std::endl;
+	for (int i = 0; i < cols.size(); i++) {
+		column_summary s = summarize_column(samples[i], level);
+		std::cout << params.get_columns()[cols[i]] << "\t" << s.mean << "\t" << s.sd << "\t" << s.hpd_lower << "\t" << s.hpd_upper << std::endl;
+	}
+	std::cerr << "used " << (cols.size() ? samples[0].size() : 0) << " samples" << std::endl;
+
+	if (summary != NULL) {
+		trajThread.join();
+		if (!trajOk) {
+			return 1;
+		}
+		if (trajSummaryName == "") {
+			trajSummaryName = baseName + ".traj.summary";
+		}
+		summary->write(trajSummaryName);
+		std::cerr << "wrote " << summary->get_count() << " trajectories to " << trajSummaryName << std::endl;
+		delete summary;
+	}
+	return 0;
+}
@@ -0,0 +1,77 @@
+/*
+ *  traj2text.cpp
+ *  Selection_Recombination
+ *
+ *  Converts a .traj.bin file written with -W back into the .traj.gz and .time.gz
+ *  files that sr writes by default
+ *
+ */
+
+#include "trajfile.h"
+#include "gzstream.h"
+#include "textbuf.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+	if (argc < 3) {
+		std::cerr << "usage: traj2text input.traj.bin output_prefix" << std::endl;
+		return 1;
+	}
+	traj_reader in;
+	if (!in.open(argv[1])) {
+		std::cerr << "ERROR: could not read " << argv[1] << std::endl;
+		return 1;
+	}
+	std::string trajName = std::string(argv[2]) + ".traj.gz";
+	std::string timeName = std::string(argv[2]) + ".time.gz";
+	ogzstream trajFile(trajName.c_str());
+	ogzstream timeFile(timeName.c_str());
+	if (!trajFile.good() || !timeFile.good()) {
+		std::cerr << "ERROR: could not open output files with base name " << argv[2] << std::endl;
+		return 1;
+	}
+
+	int gen;
+	std::vector<double> freq;
+	std::vector<double> time;
+	std::vector<double> last_time;
+	int num = 0;
+	text_buffer line;
+	while (in.next(gen, freq, time)) {
+		line.clear();
+		line.add(gen);
+		line.add(' ');
+		for (int i = 0; i < freq.size(); i++) {
+			line.add(freq[i]);
+			line.add(' ');
+		}
+		line.add('\n');
+		line.write_to(trajFile);
+		//as in sr, a line with just the generation means the grid is the same as the line before
+		line.clear();
+		line.add(gen);
+		if (num > 0 && time == last_time) {
+			line.add('\n');
+		} else {
+			line.add(' ');
+			for (int i = 0; i < time.size(); i++) {
+				line.add(time[i]);
+				line.add(' ');
+			}
+			line.add('\n');
+			last_time = time;
+		}
+		line.write_to(timeFile);
+		num++;
+	}
+	if (num != in.get_num_records()) {
+		std::cerr << "ERROR: could only read " << num << " of " << in.get_num_records() << " records" << std::endl;
+		return 1;
+	}
+	trajFile.close();
+	timeFile.close();
+	return 0;
+}
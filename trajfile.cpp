@@ -0,0 +1,306 @@
+/*
+ *  trajfile.cpp
+ *  Selection_Recombination
+ *
+ */
+
+#include "trajfile.h"
+#include <sys/types.h>
+#include <string.h>
+
+static const char traj_magic[8] = {'S','R','T','R','A','J','0','2'};
+static const char index_magic[8] = {'S','R','I','D','X','0','0','1'};
+static const uint32_t byte_order = 0x01020304;
+static const int header_size = 16;
+static const int footer_size = 24;
+static const int record_header_size = 9;
+static const int step_size = 12; //uint32 count and float64 step
+
+bool traj_writer::open(std::string name, int float_bits, int buffer_size) {
+	close();
+	if (float_bits != 32 && float_bits != 64) {
+		return false;
+	}
+	file = fopen(name.c_str(), "wb");
+	if (file == NULL) {
+		return false;
+	}
+	if (buffer_size > 0) {
+		io_buffer.resize(buffer_size);
+		setvbuf(file, &io_buffer[0], _IOFBF, buffer_size);
+	}
+	bits = float_bits;
+	pos = 0;
+	offsets.resize(0);
+	last_time.resize(0);
+	uint32_t b = bits;
+	return put(traj_magic, 8) && put(&byte_order, 4) && put(&b, 4);
+}
+
+bool traj_writer::put(const void* p, size_t n) {
+	if (n == 0) {
+		return true;
+	}
+	if (fwrite(p, 1, n, file) != n) {
+		return false;
+	}
+	pos += n;
+	return true;
+}
+
+bool traj_writer::write(int gen, const std::vector<double>& freq, const std::vector<double>& time) {
+	return write(gen, freq, time, offsets.size() > 0 && time == last_time);
+}
+
+bool traj_writer::write(int gen, const std::vector<double>& freq, const std::vector<double>& time, bool same_grid) {
+	if (file == NULL || (same_grid && (offsets.size() == 0 || freq.size() != last_n)) || (!same_grid && freq.size() != time.size())) {
+		return false;
+	}
+	offsets.push_back(pos);
+	int32_t g = gen;
+	uint32_t n = freq.size();
+	uint8_t kind = TRAJ_GRID_SAME;
+	if (!same_grid) {
+		kind = find_steps(time) ? TRAJ_GRID_STEPS : TRAJ_GRID_RAW;
+		last_time = time;
+		last_n = n;
+	}
+	bool ok = put(&g, 4) && put(&n, 4) && put(&kind, 1);
+	if (kind == TRAJ_GRID_STEPS) {
+		uint32_t m = steps.size();
+		ok = ok && put(&m, 4) && put(&time[0], sizeof(double));
+		for (int i = 0; i < m; i++) {
+			ok = ok && put(&step_counts[i], 4) && put(&steps[i], sizeof(double));
+		}
+	} else if (kind == TRAJ_GRID_RAW) {
+		ok = ok && put(&time[0], n*sizeof(double));
+	}
+	if (bits == 64) {
+		ok = ok && put(&freq[0], n*sizeof(double));
+	} else {
+		single.assign(freq.begin(), freq.end());
+		ok = ok && put(&single[0], n*sizeof(float));
+	}
+	return ok;
+}
+
+bool traj_writer::find_steps(const std::vector<double>& time) {
+	step_counts.resize(0);
+	steps.resize(0);
+	int n = time.size();
+	if (n < 2) {
+		return false;
+	}
+	//a grid made by adding dt over and over is a few runs of the same step
+	for (int i = 1; i < n; i++) {
+		if (steps.size() > 0 && time[i-1] + steps.back() == time[i]) {
+			step_counts.back()++;
+		} else {
+			double step = time[i]-time[i-1];
+			if (time[i-1] + step != time[i] || 4 + 8 + step_size*(steps.size()+1) >= n*sizeof(double)) {
+				return false;
+			}
+			step_counts.push_back(1);
+			steps.push_back(step);
+		}
+	}
+	return true;
+}
+
+bool traj_writer::close() {
+	if (file == NULL) {
+		return true;
+	}
+	uint64_t index_offset = pos;
+	uint64_t num = offsets.size();
+	bool ok = (num == 0 || put(&offsets[0], num*sizeof(uint64_t)));
+	ok = ok && put(&num, 8) && put(&index_offset, 8) && put(index_magic, 8);
+	ok = (fclose(file) == 0) && ok;
+	file = NULL;
+	return ok;
+}
+
+bool traj_reader::open(std::string name) {
+	close();
+	file = fopen(name.c_str(), "rb");
+	if (file == NULL) {
+		return false;
+	}
+	char magic[8];
+	uint32_t bom;
+	uint32_t b;
+	if (fread(magic, 1, 8, file) != 8 || memcmp(magic, traj_magic, 8) != 0
+		|| fread(&bom, 4, 1, file) != 1 || bom != byte_order
+		|| fread(&b, 4, 1, file) != 1 || (b != 32 && b != 64)) {
+		close();
+		return false;
+	}
+	bits = b;
+	fseeko(file, 0, SEEK_END);
+	uint64_t size = ftello(file);
+
+	//try the footer first
+	bool indexed = false;
+	if (size >= header_size + footer_size) {
+		uint64_t num;
+		uint64_t index_offset;
+		fseeko(file, size-footer_size, SEEK_SET);
+		if (fread(&num, 8, 1, file) == 1 && fread(&index_offset, 8, 1, file) == 1
+			&& fread(magic, 1, 8, file) == 8 && memcmp(magic, index_magic, 8) == 0
+			&& index_offset + num*8 == size-footer_size) {
+			offsets.resize(num);
+			fseeko(file, index_offset, SEEK_SET);
+			indexed = (num == 0 || fread(&offsets[0], 8, num, file) == num);
+		}
+	}
+	if (!indexed && !scan(header_size, size)) {
+		close();
+		return false;
+	}
+
+	//work out where each record's grid is stored
+	grid_record.resize(offsets.size());
+	for (int i = 0; i < offsets.size(); i++) {
+		int gen;
+		int n;
+		int kind;
+		int grid_size;
+		if (!read_header(offsets[i], gen, n, kind, grid_size) || (kind == TRAJ_GRID_SAME && i == 0)) {
+			close();
+			return false;
+		}
+		grid_record[i] = (kind == TRAJ_GRID_SAME) ? grid_record[i-1] : i;
+	}
+	next_record = 0;
+	cur_grid_record = -1;
+	return true;
+}
+
+void traj_reader::close() {
+	if (file != NULL) {
+		fclose(file);
+		file = NULL;
+	}
+	offsets.resize(0);
+	grid_record.resize(0);
+}
+
+bool traj_reader::scan(uint64_t start, uint64_t end) {
+	offsets.resize(0);
+	uint64_t pos = start;
+	int gen;
+	int n;
+	int kind;
+	int grid_size;
+	while (pos + record_header_size <= end && read_header(pos, gen, n, kind, grid_size)) {
+		uint64_t size = ftello(file)-pos + grid_size + n*bits/8;
+		if (pos + size > end) {
+			//the run stopped partway through this record
+			break;
+		}
+		offsets.push_back(pos);
+		pos += size;
+	}
+	return true;
+}
+
+bool traj_reader::read_header(uint64_t offset, int& gen, int& n, int& kind, int& grid_size) {
+	if (ftello(file) != offset) {
+		fseeko(file, offset, SEEK_SET);
+	}
+	int32_t g;
+	uint32_t m;
+	uint8_t k;
+	if (fread(&g, 4, 1, file) != 1 || fread(&m, 4, 1, file) != 1 || fread(&k, 1, 1, file) != 1 || k > TRAJ_GRID_RAW) {
+		return false;
+	}
+	gen = g;
+	n = m;
+	kind = k;
+	grid_size = 0;
+	if (kind == TRAJ_GRID_STEPS) {
+		uint32_t runs;
+		if (fread(&runs, 4, 1, file) != 1) {
+			return false;
+		}
+		grid_size = sizeof(double) + runs*step_size;
+	} else if (kind == TRAJ_GRID_RAW) {
+		grid_size = n*sizeof(double);
+	}
+	return true;
+}
+
+bool traj_reader::read_grid(int kind, int n, int grid_size) {
+	cur_time.resize(n);
+	if (kind == TRAJ_GRID_RAW) {
+		return n == 0 || fread(&cur_time[0], sizeof(double), n, file) == n;
+	}
+	//a first time and runs of steps
+	if (n == 0 || fread(&cur_time[0], sizeof(double), 1, file) != 1) {
+		return false;
+	}
+	int runs = (grid_size-sizeof(double))/step_size;
+	int i = 1;
+	for (int r = 0; r < runs; r++) {
+		uint32_t count;
+		double step;
+		if (fread(&count, 4, 1, file) != 1 || fread(&step, sizeof(double), 1, file) != 1 || count > n-i) {
+			return false;
+		}
+		for (int j = 0; j < count; j++, i++) {
+			cur_time[i] = cur_time[i-1] + step;
+		}
+	}
+	return i == n;
+}
+
+bool traj_reader::read(int i, int& gen, std::vector<double>& freq, std::vector<double>& time) {
+	if (file == NULL || i < 0 || i >= offsets.size()) {
+		return false;
+	}
+	int n;
+	int kind;
+	int grid_size;
+	if (!read_header(offsets[i], gen, n, kind, grid_size)) {
+		return false;
+	}
+	if (grid_record[i] != cur_grid_record) {
+		if (kind != TRAJ_GRID_SAME) {
+			if (!read_grid(kind, n, grid_size)) {
+				return false;
+			}
+		} else {
+			//go back for the grid, then return to this record's values
+			int g_gen;
+			int g_n;
+			int g_kind;
+			int g_grid_size;
+			if (!read_header(offsets[grid_record[i]], g_gen, g_n, g_kind, g_grid_size) || g_n != n || !read_grid(g_kind, g_n, g_grid_size)) {
+				return false;
+			}
+			fseeko(file, offsets[i]+record_header_size, SEEK_SET);
+		}
+		cur_grid_record = grid_record[i];
+	} else if (kind != TRAJ_GRID_SAME) {
+		fseeko(file, grid_size, SEEK_CUR);
+	}
+	time = cur_time;
+	freq.resize(n);
+	if (bits == 64) {
+		if (n > 0 && fread(&freq[0], sizeof(double), n, file) != n) {
+			return false;
+		}
+	} else {
+		single.resize(n);
+		if (n > 0 && fread(&single[0], sizeof(float), n, file) != n) {
+			return false;
+		}
+		freq.assign(single.begin(), single.end());
+	}
+	next_record = i+1;
+	return true;
+}
+
+bool traj_reader::next(int& gen, std::vector<double>& freq, std::vector<double>& time) {
+	return read(next_record, gen, freq, time);
+}
@@ -0,0 +1,94 @@
+/*
+ *  trajfile.h
+ *  Selection_Recombination
+ *
+ */
+
+#pragma once
+
+#ifndef trajfile_H
+#define trajfile_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+//Binary container for sampled trajectories, written instead of .traj.gz and .time.gz with -W
+//
+//  header:  "SRTRAJ02" | uint32 0x01020304 (byte order check) | uint32 float bits, 32 or 64
+//  records: int32 gen | uint32 n | uint8 grid kind | time grid | n frequencies, float32 or float64
+//           grid kind 0: same grid as the previous record, nothing stored
+//                     1: uint32 number of runs m | float64 first time | m times uint32 count,
+//                        float64 step. Each run adds its step to the time before count times,
+//                        which gives back the times exactly. Used only when it's smaller than 2
+//                     2: the n float64 times
+//  index:   uint64 offset of every record
+//  footer:  uint64 number of records | uint64 offset of the index | "SRIDX001"
+//
+//Numbers are in the byte order of the machine that wrote the file. A file from a run that
+//never finished has no index, and the reader scans the complete records instead.
+
+enum {TRAJ_GRID_SAME = 0, TRAJ_GRID_STEPS = 1, TRAJ_GRID_RAW = 2};
+
+class traj_writer {
+public:
+	traj_writer() {file = NULL;};
+	~traj_writer() {close();};
+
+	bool open(std::string name, int float_bits, int buffer_size);
+	bool is_open() {return file != NULL;};
+	bool write(int gen, const std::vector<double>& freq, const std::vector<double>& time);
+	//same, but the caller says whether the grid is the one from the last record; if so, time isn't looked at
+	bool write(int gen, const std::vector<double>& freq, const std::vector<double>& time, bool same_grid);
+	bool close(); //writes the index and footer
+
+private:
+	FILE* file;
+	int bits;
+	uint64_t pos; //bytes written so far
+	std::vector<uint64_t> offsets;
+	std::vector<double> last_time; //grid of the last record
+	int last_n; //its length
+	std::vector<uint32_t> step_counts; //runs of equal steps in the grid
+	std::vector<double> steps;
+	std::vector<float> single;
+	std::vector<char> io_buffer;
+
+	bool put(const void* p, size_t n);
+	bool find_steps(const std::vector<double>& time); //false if they wouldn't be smaller than the times
+};
+
+class traj_reader {
+public:
+	traj_reader() {file = NULL;};
+	~traj_reader() {close();};
+
+	bool open(std::string name);
+	void close();
+	int get_num_records() {return offsets.size();};
+	int get_bits() {return bits;};
+
+	//record i, in any order
+	bool read(int i, int& gen, std::vector<double>& freq, std::vector<double>& time);
+	//the record after the last one read, false at the end of the file
+	bool next(int& gen, std::vector<double>& freq, std::vector<double>& time);
+
+private:
+	FILE* file;
+	int bits;
+	std::vector<uint64_t> offsets;
+	std::vector<int> grid_record; //record that stores the grid of record i
+	int next_record;
+	int cur_grid_record; //record whose grid is in cur_time
+	std::vector<double> cur_time;
+	std::vector<float> single;
+
+	bool scan(uint64_t start, uint64_t end); //builds the index by walking the records
+	//leaves the file after the header, and the number of runs for a grid of steps; grid_size is
+	//the number of bytes of the grid after that
+	bool read_header(uint64_t offset, int& gen, int& n, int& kind, int& grid_size);
+	bool read_grid(int kind, int n, int grid_size);
+};
+
+#endif